@@ -21,6 +21,7 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
 #include <sys/mount.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -51,9 +52,18 @@ static const UnitActiveState state_translation_table[_AUTOMOUNT_STATE_MAX] = {
         [AUTOMOUNT_FAILED] = UNIT_FAILED
 };
 
+/* Maximum number of expire threads shared by all automount points */
+#define EXPIRE_WORKERS_MAX 4
+
+/* Maximum number of autofs packets read from the pipe at once */
+#define PACKETS_MAX 16
+
 struct expire_data {
         int dev_autofs_fd;
         int ioctl_fd;
+        dev_t dev_id;
+
+        LIST_FIELDS(struct expire_data, expire);
 };
 
 static inline void expire_data_free(struct expire_data *data) {
@@ -67,6 +77,14 @@ static inline void expire_data_free(struct expire_data *data) {
 
 DEFINE_TRIVIAL_CLEANUP_FUNC(struct expire_data*, expire_data_free);
 
+/* Expiring may block for a long time, for example on an unresponsive
+ * NFS server, hence it is done in threads. Instead of one thread per
+ * request, a bounded number of workers shares a queue of requests,
+ * protected by expire_mutex. Workers exit when the queue runs empty. */
+static pthread_mutex_t expire_mutex = PTHREAD_MUTEX_INITIALIZER;
+static LIST_HEAD(struct expire_data, expire_queue) = NULL;
+static unsigned n_expire_workers = 0;
+
 static int open_dev_autofs(Manager *m);
 static int automount_dispatch_io(sd_event_source *s, int fd, uint32_t events, void *userdata);
 
@@ -645,24 +663,84 @@ fail:
 }
 
 static void *expire_thread(void *p) {
-        struct autofs_dev_ioctl param;
-        _cleanup_(expire_data_freep) struct expire_data *data = (struct expire_data*)p;
+
+        for (;;) {
+                _cleanup_(expire_data_freep) struct expire_data *data = NULL;
+                struct autofs_dev_ioctl param;
+                int r;
+
+                assert_se(pthread_mutex_lock(&expire_mutex) == 0);
+
+                /* Requests are prepended, take the oldest one */
+                LIST_FIND_TAIL(expire, expire_queue, data);
+                if (data)
+                        LIST_REMOVE(expire, expire_queue, data);
+                else
+                        n_expire_workers--;
+
+                assert_se(pthread_mutex_unlock(&expire_mutex) == 0);
+
+                if (!data)
+                        return NULL;
+
+                assert(data->dev_autofs_fd >= 0);
+                assert(data->ioctl_fd >= 0);
+
+                init_autofs_dev_ioctl(&param);
+                param.ioctlfd = data->ioctl_fd;
+
+                do {
+                        r = ioctl(data->dev_autofs_fd, AUTOFS_DEV_IOCTL_EXPIRE, &param);
+                } while (r >= 0);
+
+                if (errno != EAGAIN)
+                        log_warning_errno(errno, "Failed to expire automount, ignoring: %m");
+        }
+}
+
+static int expire_enqueue(struct expire_data *data) {
+        struct expire_data *i;
+        bool spawn = false;
         int r;
 
-        assert(data->dev_autofs_fd >= 0);
-        assert(data->ioctl_fd >= 0);
+        assert(data);
 
-        init_autofs_dev_ioctl(&param);
-        param.ioctlfd = data->ioctl_fd;
+        /* Takes possession of data, in all cases */
 
-        do {
-                r = ioctl(data->dev_autofs_fd, AUTOFS_DEV_IOCTL_EXPIRE, &param);
-        } while (r >= 0);
+        assert_se(pthread_mutex_lock(&expire_mutex) == 0);
 
-        if (errno != EAGAIN)
-                log_warning_errno(errno, "Failed to expire automount, ignoring: %m");
+        /* If the same automount point is still waiting for a
+         * worker, there is no point in queuing it twice */
+        LIST_FOREACH(expire, i, expire_queue)
+                if (i->dev_id == data->dev_id)
+                        break;
 
-        return NULL;
+        if (i)
+                expire_data_free(data);
+        else {
+                LIST_PREPEND(expire, expire_queue, data);
+
+                if (n_expire_workers < EXPIRE_WORKERS_MAX) {
+                        n_expire_workers++;
+                        spawn = true;
+                }
+        }
+
+        assert_se(pthread_mutex_unlock(&expire_mutex) == 0);
+
+        if (!spawn)
+                return 0;
+
+        r = asynchronous_job(expire_thread, NULL);
+        if (r < 0) {
+                /* The request stays queued, and is picked up by
+                 * the next worker that is around */
+                assert_se(pthread_mutex_lock(&expire_mutex) == 0);
+                n_expire_workers--;
+                assert_se(pthread_mutex_unlock(&expire_mutex) == 0);
+        }
+
+        return r;
 }
 
 static int automount_dispatch_expire(sd_event_source *source, usec_t usec, void *userdata) {
@@ -678,6 +756,7 @@ static int automount_dispatch_expire(sd_event_source *source, usec_t usec, void
                 return log_oom();
 
         data->ioctl_fd = -1;
+        data->dev_id = a->dev_id;
 
         data->dev_autofs_fd = fcntl(UNIT(a)->manager->dev_autofs_fd, F_DUPFD_CLOEXEC, 3);
         if (data->dev_autofs_fd < 0)
@@ -687,12 +766,11 @@ static int automount_dispatch_expire(sd_event_source *source, usec_t usec, void
         if (data->ioctl_fd < 0)
                 return log_unit_error_errno(UNIT(a)->id, data->ioctl_fd, "Couldn't open autofs ioctl fd: %m");
 
-        r = asynchronous_job(expire_thread, data);
+        r = expire_enqueue(data);
+        data = NULL;
         if (r < 0)
                 return log_unit_error_errno(UNIT(a)->id, r, "Failed to start expire job: %m");
 
-        data = NULL;
-
         return automount_start_expire(a);
 }
 
@@ -767,6 +845,11 @@ static void automount_enter_running(Automount *a) {
                 goto fail;
         }
 
+        /* A mount job is already on its way, the new requests will
+         * be answered together with the earlier ones once it is done */
+        if (a->state == AUTOMOUNT_RUNNING && trigger->job && trigger->job->type == JOB_START)
+                return;
+
         r = manager_add_job(UNIT(a)->manager, JOB_START, trigger, JOB_REPLACE, true, &error, NULL);
         if (r < 0) {
                 log_unit_warning(UNIT(a)->id,
@@ -946,11 +1029,43 @@ static bool automount_may_gc(Unit *u) {
         return UNIT_VTABLE(t)->may_gc(t);
 }
 
-static int automount_dispatch_io(sd_event_source *s, int fd, uint32_t events, void *userdata) {
+static int automount_queue_umount(Automount *a) {
         _cleanup_bus_error_free_ sd_bus_error error = SD_BUS_ERROR_NULL;
-        union autofs_v5_packet_union packet;
-        Automount *a = AUTOMOUNT(userdata);
         Unit *trigger;
+        int r;
+
+        assert(a);
+
+        (void) sd_event_source_set_enabled(a->expire_event_source, SD_EVENT_OFF);
+
+        trigger = UNIT_TRIGGER(UNIT(a));
+        if (!trigger) {
+                log_unit_error(UNIT(a)->id, "Unit to trigger vanished.");
+                return -ENOENT;
+        }
+
+        /* Don't bother with another transaction if the umount is
+         * already queued */
+        if (trigger->job && trigger->job->type == JOB_STOP)
+                return 0;
+
+        r = manager_add_job(UNIT(a)->manager, JOB_STOP, trigger, JOB_REPLACE, true, &error, NULL);
+        if (r < 0) {
+                log_unit_warning(UNIT(a)->id,
+                                 "%s failed to queue umount startup job: %s",
+                                 UNIT(a)->id, bus_error_message(&error, r));
+                return r;
+        }
+
+        return 0;
+}
+
+static int automount_dispatch_io(sd_event_source *s, int fd, uint32_t events, void *userdata) {
+        union autofs_v5_packet_union packets[PACKETS_MAX];
+        Automount *a = AUTOMOUNT(userdata);
+        bool missing = false, expire = false;
+        int last = -1;
+        size_t i, n;
         ssize_t l;
         int r;
 
@@ -963,79 +1078,96 @@ static int automount_dispatch_io(sd_event_source *s, int fd, uint32_t events, vo
                 goto fail;
         }
 
-        l = loop_read(a->pipe_fd, &packet, sizeof(packet), true);
-        if (l != sizeof(packet)) {
-                if (l < 0)
-                        log_unit_error_errno(UNIT(a)->id, l, "Invalid read from pipe: %m");
-                else
-                        log_unit_error(UNIT(a)->id, "Invalid read from pipe: short read");
+        /* The kernel writes each packet atomically, hence we can
+         * drain a whole burst of them at once and still only ever
+         * see complete ones. */
+        l = read(a->pipe_fd, packets, sizeof(packets));
+        if (l < 0) {
+                if (errno == EAGAIN || errno == EINTR)
+                        return 0;
+
+                log_unit_error_errno(UNIT(a)->id, errno, "Invalid read from pipe: %m");
+                goto fail;
+        }
+        if (l == 0 || (size_t) l % sizeof(packets[0]) != 0) {
+                log_unit_error(UNIT(a)->id, "Invalid read from pipe: short read");
                 goto fail;
         }
 
-        switch (packet.hdr.type) {
+        n = (size_t) l / sizeof(packets[0]);
 
-        case autofs_ptype_missing_direct:
+        for (i = 0; i < n; i++) {
+                union autofs_v5_packet_union *packet = packets + i;
 
-                if (packet.v5_packet.pid > 0) {
-                        _cleanup_free_ char *p = NULL;
+                switch (packet->hdr.type) {
 
-                        get_process_comm(packet.v5_packet.pid, &p);
-                        log_unit_info(UNIT(a)->id,
-                                       "Got automount request for %s, triggered by %"PRIu32" (%s)",
-                                       a->where, packet.v5_packet.pid, strna(p));
-                } else
-                        log_unit_debug(UNIT(a)->id, "Got direct mount request on %s", a->where);
+                case autofs_ptype_missing_direct:
 
-                r = set_ensure_allocated(&a->tokens, NULL);
-                if (r < 0) {
-                        log_unit_error(UNIT(a)->id, "Failed to allocate token set.");
-                        goto fail;
-                }
+                        if (packet->v5_packet.pid > 0) {
+                                _cleanup_free_ char *p = NULL;
 
-                r = set_put(a->tokens, UINT_TO_PTR(packet.v5_packet.wait_queue_token));
-                if (r < 0) {
-                        log_unit_error_errno(UNIT(a)->id, r, "Failed to remember token: %m");
-                        goto fail;
-                }
+                                get_process_comm(packet->v5_packet.pid, &p);
+                                log_unit_info(UNIT(a)->id,
+                                              "Got automount request for %s, triggered by %"PRIu32" (%s)",
+                                              a->where, packet->v5_packet.pid, strna(p));
+                        } else
+                                log_unit_debug(UNIT(a)->id, "Got direct mount request on %s", a->where);
 
-                automount_enter_running(a);
-                break;
+                        r = set_ensure_allocated(&a->tokens, NULL);
+                        if (r < 0) {
+                                log_unit_error(UNIT(a)->id, "Failed to allocate token set.");
+                                goto fail;
+                        }
 
-        case autofs_ptype_expire_direct:
-                log_unit_debug(UNIT(a)->id, "Got direct umount request on %s", a->where);
+                        r = set_put(a->tokens, UINT_TO_PTR(packet->v5_packet.wait_queue_token));
+                        if (r < 0) {
+                                log_unit_error_errno(UNIT(a)->id, r, "Failed to remember token: %m");
+                                goto fail;
+                        }
 
-                (void) sd_event_source_set_enabled(a->expire_event_source, SD_EVENT_OFF);
+                        missing = true;
+                        last = packet->hdr.type;
+                        break;
 
-                r = set_ensure_allocated(&a->expire_tokens, NULL);
-                if (r < 0) {
-                        log_unit_error(UNIT(a)->id, "Failed to allocate token set.");
-                        goto fail;
-                }
+                case autofs_ptype_expire_direct:
+                        log_unit_debug(UNIT(a)->id, "Got direct umount request on %s", a->where);
 
-                r = set_put(a->expire_tokens, UINT_TO_PTR(packet.v5_packet.wait_queue_token));
-                if (r < 0) {
-                        log_unit_error_errno(UNIT(a)->id, r, "Failed to remember token: %m");
-                        goto fail;
-                }
+                        r = set_ensure_allocated(&a->expire_tokens, NULL);
+                        if (r < 0) {
+                                log_unit_error(UNIT(a)->id, "Failed to allocate token set.");
+                                goto fail;
+                        }
 
-                trigger = UNIT_TRIGGER(UNIT(a));
-                if (!trigger) {
-                        log_unit_error(UNIT(a)->id, "Unit to trigger vanished.");
-                        goto fail;
+                        r = set_put(a->expire_tokens, UINT_TO_PTR(packet->v5_packet.wait_queue_token));
+                        if (r < 0) {
+                                log_unit_error_errno(UNIT(a)->id, r, "Failed to remember token: %m");
+                                goto fail;
+                        }
+
+                        expire = true;
+                        last = packet->hdr.type;
+                        break;
+
+                default:
+                        log_unit_error(UNIT(a)->id, "Received unknown automount request %i", packet->hdr.type);
+                        break;
                 }
-                r = manager_add_job(UNIT(a)->manager, JOB_STOP, trigger, JOB_REPLACE, true, &error, NULL);
-                if (r < 0) {
-                        log_unit_warning(UNIT(a)->id,
-                                         "%s failed to queue umount startup job: %s",
-                                         UNIT(a)->id, bus_error_message(&error, r));
+        }
+
+        /* All requests of one kind in the burst are served by a
+         * single job. If both kinds showed up, queue them in the
+         * order of the most recent request, so that it wins. */
+        if (expire && (!missing || last == autofs_ptype_missing_direct))
+                if (automount_queue_umount(a) < 0)
                         goto fail;
-                }
-                break;
 
-        default:
-                log_unit_error(UNIT(a)->id, "Received unknown automount request %i", packet.hdr.type);
-                break;
-        }
+        if (missing)
+                automount_enter_running(a);
+
+        if (expire && missing && last == autofs_ptype_expire_direct &&
+            IN_SET(a->state, AUTOMOUNT_WAITING, AUTOMOUNT_RUNNING))
+                if (automount_queue_umount(a) < 0)
+                        goto fail;
 
         return 0;
 
@@ -1045,8 +1177,19 @@ fail:
 }
 
 static void automount_shutdown(Manager *m) {
+        struct expire_data *d;
+
         assert(m);
 
+        /* Drop requests no worker picked up yet, the ones in
+         * progress are cleaned up by their workers */
+        assert_se(pthread_mutex_lock(&expire_mutex) == 0);
+        while ((d = expire_queue)) {
+                LIST_REMOVE(expire, expire_queue, d);
+                expire_data_free(d);
+        }
+        assert_se(pthread_mutex_unlock(&expire_mutex) == 0);
+
         m->dev_autofs_fd = safe_close(m->dev_autofs_fd);
 }
 
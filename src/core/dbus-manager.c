@@ -624,6 +624,7 @@ static int transient_unit_from_message(
                 Manager *m,
                 sd_bus_message *message,
                 const char *name,
+                UnitSetPropertiesMode mode,
                 Unit **unit,
                 sd_bus_error *error) {
 
@@ -655,12 +656,12 @@ static int transient_unit_from_message(
 
         /* OK, the unit failed to load and is unreferenced, now let's
          * fill in the transient data instead */
-        r = unit_make_transient(u);
+        r = unit_make_transient(u, mode);
         if (r < 0)
                 return r;
 
         /* Set our properties */
-        r = bus_unit_set_properties(u, message, UNIT_RUNTIME, false, error);
+        r = bus_unit_set_properties(u, message, mode, false, error);
         if (r < 0)
                 return r;
 
@@ -672,6 +673,7 @@ static int transient_unit_from_message(
 static int transient_aux_units_from_message(
                 Manager *m,
                 sd_bus_message *message,
+                UnitSetPropertiesMode mode,
                 sd_bus_error *error) {
 
         Unit *u;
@@ -693,7 +695,7 @@ static int transient_aux_units_from_message(
                 if (r < 0)
                         return r;
 
-                r = transient_unit_from_message(m, message, name, &u, error);
+                r = transient_unit_from_message(m, message, name, mode, &u, error);
                 if (r < 0 && r != -EEXIST)
                         return r;
 
@@ -754,11 +756,11 @@ static int method_start_transient_unit(sd_bus *bus, sd_bus_message *message, voi
         if (r < 0)
                 return r;
 
-        r = transient_unit_from_message(m, message, name, &u, error);
+        r = transient_unit_from_message(m, message, name, UNIT_RUNTIME, &u, error);
         if (r < 0)
                 return r;
 
-        r = transient_aux_units_from_message(m, message, error);
+        r = transient_aux_units_from_message(m, message, UNIT_RUNTIME, error);
         if (r < 0)
                 return r;
 
@@ -773,6 +775,190 @@ static int method_start_transient_unit(sd_bus *bus, sd_bus_message *message, voi
         return bus_unit_queue_job(bus, message, u, JOB_START, mode, false, error);
 }
 
+static int method_start_transient_units(sd_bus *bus, sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_bus_message_unref_ sd_bus_message *reply = NULL;
+        _cleanup_free_ Unit **units = NULL;
+        unsigned n_units = 0, i;
+        size_t n_allocated = 0;
+        Manager *m = userdata;
+        const char *smode;
+        JobMode mode;
+        int runtime, r;
+
+        assert(bus);
+        assert(message);
+        assert(m);
+
+        /* Like StartTransientUnit(), but sets up any number of units,
+         * and starts them all in one transaction. Unless asked for,
+         * nothing is written to /run for scope units. Their state and
+         * cgroup survive a daemon reload via serialization, but the
+         * settings they were created with don't, which is fine for
+         * the typical short-lived scope. All other units are written
+         * to /run as usual, since they wouldn't even survive a reload
+         * otherwise. Returns exactly one job path per unit, in the order
+         * the units were specified, or "/" for units that ended up
+         * without a job, e.g. because it finished right away. If any
+         * of the units can't be set up, the ones that were set up
+         * already are unloaded again. */
+
+        r = bus_verify_manage_unit_async(m, message, error);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                return 1; /* No authorization for now, but the async polkit stuff will call us again when it has it */
+
+        r = sd_bus_message_read(message, "sb", &smode, &runtime);
+        if (r < 0)
+                return r;
+
+        mode = job_mode_from_string(smode);
+        if (mode < 0)
+                return sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "Job mode %s is invalid.", smode);
+
+        r = mac_selinux_runtime_unit_access_check(message, "start", error);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_enter_container(message, 'a', "(sa(sv))");
+        if (r < 0)
+                return r;
+
+        while ((r = sd_bus_message_enter_container(message, 'r', "sa(sv)")) > 0) {
+                const char *name;
+                UnitType t;
+                Unit *u;
+
+                r = sd_bus_message_read(message, "s", &name);
+                if (r < 0)
+                        goto fail;
+
+                t = unit_name_to_type(name);
+                if (t < 0) {
+                        r = sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "Invalid unit type.");
+                        goto fail;
+                }
+
+                if (!unit_vtable[t]->can_transient) {
+                        r = sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "Unit type %s does not support transient units.", unit_type_to_string(t));
+                        goto fail;
+                }
+
+                r = transient_unit_from_message(m, message, name,
+                                                t == UNIT_SCOPE && !runtime ? UNIT_MEMORY : UNIT_RUNTIME,
+                                                &u, error);
+                if (r < 0) {
+                        /* The unit might have been half set up */
+                        u = manager_get_unit(m, name);
+                        if (u)
+                                unit_add_to_gc_queue(u);
+
+                        goto fail;
+                }
+
+                if (!GREEDY_REALLOC(units, n_allocated, n_units + 1)) {
+                        unit_add_to_gc_queue(u);
+                        r = -ENOMEM;
+                        goto fail;
+                }
+
+                units[n_units++] = u;
+
+                r = unit_load(u);
+                if (r < 0)
+                        goto fail;
+
+                r = sd_bus_message_exit_container(message);
+                if (r < 0)
+                        goto fail;
+        }
+        if (r < 0)
+                goto fail;
+
+        r = sd_bus_message_exit_container(message);
+        if (r < 0)
+                goto fail;
+
+        r = transient_aux_units_from_message(m, message, UNIT_RUNTIME, error);
+        if (r < 0)
+                goto fail;
+
+        manager_dispatch_load_queue(m);
+
+        for (i = 0; i < n_units; i++) {
+                r = mac_selinux_unit_access_check(units[i], message, "start", error);
+                if (r < 0)
+                        goto fail;
+
+                if (units[i]->refuse_manual_start) {
+                        r = sd_bus_error_setf(error, BUS_ERROR_ONLY_BY_DEPENDENCY, "Operation refused, unit %s may be requested by dependency only (it is configured to refuse manual start/stop).", units[i]->id);
+                        goto fail;
+                }
+        }
+
+        /* Finally, start them */
+        r = manager_add_jobs(m, JOB_START, units, n_units, mode, true, error);
+        if (r < 0)
+                goto fail;
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "o");
+        if (r < 0)
+                return r;
+
+        for (i = 0; i < n_units; i++) {
+                _cleanup_free_ char *path = NULL;
+                Job *j = units[i]->job;
+
+                /* A job might have been finished right away */
+                if (!j) {
+                        r = sd_bus_message_append(reply, "o", "/");
+                        if (r < 0)
+                                return r;
+
+                        continue;
+                }
+
+                if (bus == m->api_bus) {
+                        if (!j->clients) {
+                                r = sd_bus_track_new(bus, &j->clients, NULL, NULL);
+                                if (r < 0)
+                                        return r;
+                        }
+
+                        r = sd_bus_track_add_sender(j->clients, message);
+                        if (r < 0)
+                                return r;
+                }
+
+                path = job_dbus_path(j);
+                if (!path)
+                        return -ENOMEM;
+
+                r = sd_bus_message_append(reply, "o", path);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(bus, reply, NULL);
+
+fail:
+        /* Unload what we set up so far, unless something else
+         * picked it up in the meantime. Transient units are removed
+         * from /run when they are unloaded. */
+        for (i = 0; i < n_units; i++)
+                unit_add_to_gc_queue(units[i]);
+
+        return r;
+}
+
 static int method_get_job(sd_bus *bus, sd_bus_message *message, void *userdata, sd_bus_error *error) {
         _cleanup_free_ char *path = NULL;
         Manager *m = userdata;
@@ -860,6 +1046,39 @@ static int method_reset_failed(sd_bus *bus, sd_bus_message *message, void *userd
         return sd_bus_reply_method_return(message, NULL);
 }
 
+static int reply_unit_info(sd_bus_message *reply, Unit *u) {
+        _cleanup_free_ char *unit_path = NULL, *job_path = NULL;
+        Unit *following;
+
+        assert(reply);
+        assert(u);
+
+        following = unit_following(u);
+
+        unit_path = unit_dbus_path(u);
+        if (!unit_path)
+                return -ENOMEM;
+
+        if (u->job) {
+                job_path = job_dbus_path(u->job);
+                if (!job_path)
+                        return -ENOMEM;
+        }
+
+        return sd_bus_message_append(
+                        reply, "(ssssssouso)",
+                        u->id,
+                        unit_description(u),
+                        unit_load_state_to_string(u->load_state),
+                        unit_active_state_to_string(unit_active_state(u)),
+                        unit_sub_state_to_string(u),
+                        following ? following->id : "",
+                        unit_path,
+                        u->job ? u->job->id : 0,
+                        u->job ? job_type_to_string(u->job->type) : "",
+                        job_path ? job_path : "/");
+}
+
 static int list_units_filtered(sd_bus *bus, sd_bus_message *message, void *userdata, sd_bus_error *error, char **states) {
         _cleanup_bus_message_unref_ sd_bus_message *reply = NULL;
         Manager *m = userdata;
@@ -887,42 +1106,16 @@ static int list_units_filtered(sd_bus *bus, sd_bus_message *message, void *userd
                 return r;
 
         HASHMAP_FOREACH_KEY(u, k, m->units, i) {
-                _cleanup_free_ char *unit_path = NULL, *job_path = NULL;
-                Unit *following;
-
                 if (k != u->id)
                         continue;
 
-                following = unit_following(u);
-
                 if (!strv_isempty(states) &&
                     !strv_contains(states, unit_load_state_to_string(u->load_state)) &&
                     !strv_contains(states, unit_active_state_to_string(unit_active_state(u))) &&
                     !strv_contains(states, unit_sub_state_to_string(u)))
                         continue;
 
-                unit_path = unit_dbus_path(u);
-                if (!unit_path)
-                        return -ENOMEM;
-
-                if (u->job) {
-                        job_path = job_dbus_path(u->job);
-                        if (!job_path)
-                                return -ENOMEM;
-                }
-
-                r = sd_bus_message_append(
-                                reply, "(ssssssouso)",
-                                u->id,
-                                unit_description(u),
-                                unit_load_state_to_string(u->load_state),
-                                unit_active_state_to_string(unit_active_state(u)),
-                                unit_sub_state_to_string(u),
-                                following ? following->id : "",
-                                unit_path,
-                                u->job ? u->job->id : 0,
-                                u->job ? job_type_to_string(u->job->type) : "",
-                                job_path ? job_path : "/");
+                r = reply_unit_info(reply, u);
                 if (r < 0)
                         return r;
         }
@@ -949,6 +1142,71 @@ static int method_list_units_filtered(sd_bus *bus, sd_bus_message *message, void
         return list_units_filtered(bus, message, userdata, error, states);
 }
 
+static int method_list_units_by_names(sd_bus *bus, sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_bus_message_unref_ sd_bus_message *reply = NULL;
+        _cleanup_strv_free_ char **names = NULL;
+        Manager *m = userdata;
+        char **name;
+        int r;
+
+        assert(bus);
+        assert(message);
+        assert(m);
+
+        /* Anyone can call this method */
+
+        r = mac_selinux_access_check(message, "status", error);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &names);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(ssssssouso)");
+        if (r < 0)
+                return r;
+
+        /* Like GetUnit() this does not load units that are not
+         * loaded yet. This allows clients to query the state of
+         * many units in a single round trip. Exactly one entry is
+         * returned for each name, in the order the names were
+         * specified, so that callers can match them up even if a
+         * name is an alias. For names the manager does not know
+         * about, an entry with the name as specified, empty states
+         * and "/" as object path is returned. */
+
+        STRV_FOREACH(name, names) {
+                Unit *u;
+
+                u = manager_get_unit(m, *name);
+                if (!u) {
+                        r = sd_bus_message_append(
+                                        reply, "(ssssssouso)",
+                                        *name, "", "", "", "", "",
+                                        "/", (uint32_t) 0, "", "/");
+                        if (r < 0)
+                                return r;
+
+                        continue;
+                }
+
+                r = reply_unit_info(reply, u);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(bus, reply, NULL);
+}
+
 static int method_list_jobs(sd_bus *bus, sd_bus_message *message, void *userdata, sd_bus_error *error) {
         _cleanup_bus_message_unref_ sd_bus_message *reply = NULL;
         Manager *m = userdata;
@@ -2103,12 +2361,14 @@ const sd_bus_vtable bus_manager_vtable[] = {
         SD_BUS_METHOD("ResetFailedUnit", "s", NULL, method_reset_failed_unit, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("SetUnitProperties", "sba(sv)", NULL, method_set_unit_properties, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("StartTransientUnit", "ssa(sv)a(sa(sv))", "o", method_start_transient_unit, SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD("StartTransientUnits", "sba(sa(sv))a(sa(sv))", "ao", method_start_transient_units, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("GetJob", "u", "o", method_get_job, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("CancelJob", "u", NULL, method_cancel_job, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("ClearJobs", NULL, NULL, method_clear_jobs, 0),
         SD_BUS_METHOD("ResetFailed", NULL, NULL, method_reset_failed, 0),
         SD_BUS_METHOD("ListUnits", NULL, "a(ssssssouso)", method_list_units, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("ListUnitsFiltered", "as", "a(ssssssouso)", method_list_units_filtered, SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD("ListUnitsByNames", "as", "a(ssssssouso)", method_list_units_by_names, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("ListJobs", NULL, "a(usssoo)", method_list_jobs, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("Subscribe", NULL, NULL, method_subscribe, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("Unsubscribe", NULL, NULL, method_unsubscribe, SD_BUS_VTABLE_UNPRIVILEGED),
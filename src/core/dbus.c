@@ -42,6 +42,7 @@
 #include "bus-common-errors.h"
 #include "strxcpyx.h"
 #include "bus-internal.h"
+#include "bus-track.h"
 #include "selinux-access.h"
 
 #define CONNECTIONS_MAX 4096
@@ -1152,22 +1153,13 @@ int bus_track_coldplug(Manager *m, sd_bus_track **t, char ***l) {
         assert(l);
 
         if (!strv_isempty(*l) && m->api_bus) {
-                char **i;
-
                 if (!*t) {
                         r = sd_bus_track_new(m->api_bus, t, NULL, NULL);
                         if (r < 0)
                                 return r;
                 }
 
-                r = 0;
-                STRV_FOREACH(i, *l) {
-                        int k;
-
-                        k = sd_bus_track_add_name(*t, *i);
-                        if (k < 0)
-                                r = k;
-                }
+                r = bus_track_add_names(*t, *l);
         }
 
         strv_free(*l);
@@ -455,6 +455,7 @@ int job_type_merge_and_collapse(JobType *a, JobType b, Unit *u) {
 static bool job_is_runnable(Job *j) {
         Iterator i;
         Unit *other;
+        unsigned n = 0;
 
         assert(j);
         assert(j->installed);
@@ -469,6 +470,8 @@ static bool job_is_runnable(Job *j) {
          * unit_start() they can indicate they are not
          * runnable yet. */
 
+        j->n_blockers = 0;
+
         /* First check if there is an override */
         if (j->ignore_order)
                 return true;
@@ -476,6 +479,14 @@ static bool job_is_runnable(Job *j) {
         if (j->type == JOB_NOP)
                 return true;
 
+        /* All jobs we have to wait for are counted, rather than
+         * stopping at the first one. job_finish_and_invalidate()
+         * counts them down again, and only queues us for another
+         * look once the last one is gone. Otherwise a job ordered
+         * after thousands of others (think shutdown.target) would
+         * be rechecked against all of them each time one of them
+         * finishes. */
+
         if (j->type == JOB_START ||
             j->type == JOB_VERIFY_ACTIVE ||
             j->type == JOB_RELOAD) {
@@ -487,7 +498,7 @@ static bool job_is_runnable(Job *j) {
 
                 SET_FOREACH(other, j->unit->dependencies[UNIT_AFTER], i)
                         if (other->job)
-                                return false;
+                                n++;
         }
 
         /* Also, if something else is being stopped and we should
@@ -497,7 +508,7 @@ static bool job_is_runnable(Job *j) {
                 if (other->job &&
                     (other->job->type == JOB_STOP ||
                      other->job->type == JOB_RESTART))
-                        return false;
+                        n++;
 
         /* This means that for a service a and a service b where b
          * shall be started after a:
@@ -510,7 +521,25 @@ static bool job_is_runnable(Job *j) {
          *  This has the side effect that restarts are properly
          *  synchronized too. */
 
-        return true;
+        j->n_blockers = n;
+        return n == 0;
+}
+
+static void job_unblock(Job *j) {
+        assert(j);
+
+        /* Some job j is ordered against is gone. The count may be
+         * too low, since jobs installed later are not accounted
+         * for, but then job_is_runnable() simply looks again. It is
+         * never too high, since a job never stops blocking others
+         * without passing through job_finish_and_invalidate(). */
+        if (j->n_blockers > 1) {
+                j->n_blockers--;
+                return;
+        }
+
+        j->n_blockers = 0;
+        job_add_to_run_queue(j);
 }
 
 static void job_change_type(Job *j, JobType newtype) {
@@ -926,10 +955,10 @@ finish:
         /* Try to start the next jobs that can be started */
         SET_FOREACH(other, u->dependencies[UNIT_AFTER], i)
                 if (other->job)
-                        job_add_to_run_queue(other->job);
+                        job_unblock(other->job);
         SET_FOREACH(other, u->dependencies[UNIT_BEFORE], i)
                 if (other->job)
-                        job_add_to_run_queue(other->job);
+                        job_unblock(other->job);
 
         manager_check_finished(u->manager);
 
@@ -144,6 +144,10 @@ struct Job {
         Job* marker;
         unsigned generation;
 
+        /* How many other jobs this job was last found waiting for,
+         * see job_is_runnable() */
+        unsigned n_blockers;
+
         uint32_t id;
 
         JobType type;
@@ -21,6 +21,7 @@
 
 #include <sys/wait.h>
 #include <signal.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
 
@@ -30,12 +31,12 @@
 #include "set.h"
 
 #define TIMEOUT_USEC (10 * USEC_PER_SEC)
+#define SWEEP_USEC (100 * USEC_PER_MSEC)
 
-static bool ignore_proc(pid_t pid) {
-        _cleanup_fclose_ FILE *f = NULL;
-        char c;
-        const char *p;
-        size_t count;
+static bool ignore_proc(int proc_fd, const char *name, pid_t pid) {
+        _cleanup_close_ int fd = -1;
+        char c, p[DECIMAL_STR_MAX(pid_t) + sizeof("/cmdline")];
+        ssize_t count;
         uid_t uid;
         int r;
 
@@ -43,37 +44,36 @@ static bool ignore_proc(pid_t pid) {
         if (pid == 1)
                 return true;
 
-        r = get_process_uid(pid, &uid);
-        if (r < 0)
-                return true; /* not really, but better safe than sorry */
-
-        /* Non-root processes otherwise are always subject to be killed */
-        if (uid != 0)
-                return false;
-
-        p = procfs_file_alloca(pid, "cmdline");
-        f = fopen(p, "re");
-        if (!f)
+        /* Look at the first byte of the command line first, which
+         * settles it for almost all processes. Only for the rare
+         * exceptions the real UID needs to be read from the status
+         * file. */
+        xsprintf(p, "%s/cmdline", name);
+        fd = openat(proc_fd, p, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
                 return true; /* not really, but has the desired effect */
 
-        count = fread(&c, 1, 1, f);
-
-        /* Kernel threads have an empty cmdline */
-        if (count <= 0)
-                return true;
+        count = read(fd, &c, 1);
 
         /* Processes with argv[0][0] = '@' we ignore from the killing
-         * spree.
+         * spree. Kernel threads have an empty cmdline.
          *
          * http://www.freedesktop.org/wiki/Software/systemd/RootStorageDaemons */
-        if (count == 1 && c == '@')
+        if (count == 1 && c != '@')
+                return false;
+
+        /* Non-root processes otherwise are always subject to be
+         * killed. Note that this needs to be the real UID, the
+         * owner of /proc/$PID is the effective one. */
+        r = get_process_uid(pid, &uid);
+        if (r < 0)
                 return true;
 
-        return false;
+        return uid == 0;
 }
 
 static void wait_for_children(Set *pids, sigset_t *mask) {
-        usec_t until;
+        usec_t until, swept = 0;
 
         assert(mask);
 
@@ -83,6 +83,7 @@ static void wait_for_children(Set *pids, sigset_t *mask) {
         until = now(CLOCK_MONOTONIC) + TIMEOUT_USEC;
         for (;;) {
                 struct timespec ts;
+                bool children = true;
                 int k;
                 usec_t n;
                 void *p;
@@ -99,8 +100,10 @@ static void wait_for_children(Set *pids, sigset_t *mask) {
                         if (pid == 0)
                                 break;
                         if (pid < 0) {
-                                if (errno == ECHILD)
+                                if (errno == ECHILD) {
+                                        children = false;
                                         break;
+                                }
 
                                 log_error_errno(errno, "waitpid() failed: %m");
                                 return;
@@ -109,29 +112,40 @@ static void wait_for_children(Set *pids, sigset_t *mask) {
                         set_remove(pids, ULONG_TO_PTR(pid));
                 }
 
+                if (set_isempty(pids))
+                        return;
+
                 /* Now explicitly check who might be remaining, who
-                 * might not be our child. */
-                SET_FOREACH(p, pids, i) {
+                 * might not be our child. Processes that are not
+                 * our children don't wake us up when they die, but
+                 * checking all of them on every SIGCHLD is quadratic,
+                 * hence do so only every SWEEP_USEC, or once we have
+                 * no children left to wait for. */
+                n = now(CLOCK_MONOTONIC);
+                if (!children || n >= swept + SWEEP_USEC) {
+                        SET_FOREACH(p, pids, i) {
 
-                        /* We misuse getpgid as a check whether a
-                         * process still exists. */
-                        if (getpgid((pid_t) PTR_TO_ULONG(p)) >= 0)
-                                continue;
+                                /* We misuse getpgid as a check whether a
+                                 * process still exists. */
+                                if (getpgid((pid_t) PTR_TO_ULONG(p)) >= 0)
+                                        continue;
 
-                        if (errno != ESRCH)
-                                continue;
+                                if (errno != ESRCH)
+                                        continue;
 
-                        set_remove(pids, p);
-                }
+                                set_remove(pids, p);
+                        }
 
-                if (set_isempty(pids))
-                        return;
+                        if (set_isempty(pids))
+                                return;
+
+                        swept = n;
+                }
 
-                n = now(CLOCK_MONOTONIC);
                 if (n >= until)
                         return;
 
-                timespec_store(&ts, until - n);
+                timespec_store(&ts, MIN(until, swept + SWEEP_USEC) - n);
                 k = sigtimedwait(mask, NULL, &ts);
                 if (k != SIGCHLD) {
 
@@ -164,7 +178,7 @@ static int killall(int sig, Set *pids, bool send_sighup) {
                 if (parse_pid(d->d_name, &pid) < 0)
                         continue;
 
-                if (ignore_proc(pid))
+                if (ignore_proc(dirfd(dir), d->d_name, pid))
                         continue;
 
                 if (sig == SIGKILL) {
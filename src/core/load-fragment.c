@@ -1791,7 +1791,6 @@ int config_parse_path_spec(const char *unit,
         s->path = path_kill_slashes(k);
         k = NULL;
         s->type = b;
-        s->inotify_fd = -1;
 
         LIST_PREPEND(spec, p->specs, s);
 
@@ -544,7 +544,7 @@ int manager_new(SystemdRunningAs running_as, bool test_run, Manager **_m) {
 
         m->idle_pipe[0] = m->idle_pipe[1] = m->idle_pipe[2] = m->idle_pipe[3] = -1;
 
-        m->pin_cgroupfs_fd = m->notify_fd = m->cgroups_agent_fd = m->signal_fd = m->time_change_fd = m->dev_autofs_fd = m->private_listen_fd = m->kdbus_fd = m->utab_inotify_fd = -1;
+        m->pin_cgroupfs_fd = m->notify_fd = m->cgroups_agent_fd = m->signal_fd = m->time_change_fd = m->dev_autofs_fd = m->private_listen_fd = m->kdbus_fd = m->utab_inotify_fd = m->path_inotify_fd = -1;
         m->current_job_id = 1; /* start as id #1, so that we can leave #0 around as "null-like" value */
 
         m->ask_password_inotify_fd = -1;
@@ -1341,6 +1341,18 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds) {
         return r;
 }
 
+static void manager_load_deferred_unit(Manager *m, Unit *u) {
+        assert(m);
+        assert(u);
+
+        if (!u->load_deferred)
+                return;
+
+        u->load_deferred = false;
+        unit_add_to_load_queue(u);
+        manager_dispatch_load_queue(m);
+}
+
 int manager_add_job(Manager *m, JobType type, Unit *unit, JobMode mode, bool override, sd_bus_error *e, Job **_ret) {
         int r;
         Transaction *tr;
@@ -1353,6 +1365,8 @@ int manager_add_job(Manager *m, JobType type, Unit *unit, JobMode mode, bool ove
         if (mode == JOB_ISOLATE && type != JOB_START)
                 return sd_bus_error_setf(e, SD_BUS_ERROR_INVALID_ARGS, "Isolate is only valid for start.");
 
+        manager_load_deferred_unit(m, unit);
+
         if (mode == JOB_ISOLATE && !unit->allow_isolate)
                 return sd_bus_error_setf(e, BUS_ERROR_NO_ISOLATION, "Operation refused, unit may not be isolated.");
 
@@ -1398,6 +1412,59 @@ tr_abort:
         return r;
 }
 
+int manager_add_jobs(Manager *m, JobType type, Unit **units, unsigned n_units, JobMode mode, bool override, sd_bus_error *e) {
+        Transaction *tr;
+        unsigned i;
+        int r;
+
+        assert(m);
+        assert(type < _JOB_TYPE_MAX);
+        assert(units || n_units == 0);
+        assert(mode < _JOB_MODE_MAX);
+
+        /* Like manager_add_job(), but enqueues jobs for a number of
+         * units in one transaction. The first unit's job is the
+         * anchor, the others are hooked up to it. Afterwards the jobs
+         * may be found in the units' job fields. */
+
+        if (n_units == 0)
+                return 0;
+
+        if (mode == JOB_ISOLATE)
+                return sd_bus_error_setf(e, SD_BUS_ERROR_INVALID_ARGS, "Isolate is not valid for multiple units.");
+
+        for (i = 0; i < n_units; i++)
+                manager_load_deferred_unit(m, units[i]);
+
+        tr = transaction_new(mode == JOB_REPLACE_IRREVERSIBLY);
+        if (!tr)
+                return -ENOMEM;
+
+        for (i = 0; i < n_units; i++) {
+                log_unit_debug(units[i]->id,
+                               "Trying to enqueue job %s/%s/%s", units[i]->id,
+                               job_type_to_string(type), job_mode_to_string(mode));
+
+                r = transaction_add_job_and_dependencies(tr, job_type_collapse(type, units[i]), units[i], tr->anchor_job, true, override, false,
+                                                         mode == JOB_IGNORE_DEPENDENCIES || mode == JOB_IGNORE_REQUIREMENTS,
+                                                         mode == JOB_IGNORE_DEPENDENCIES, e);
+                if (r < 0)
+                        goto tr_abort;
+        }
+
+        r = transaction_activate(tr, m, mode, e);
+        if (r < 0)
+                goto tr_abort;
+
+        transaction_free(tr);
+        return 0;
+
+tr_abort:
+        transaction_abort(tr);
+        transaction_free(tr);
+        return r;
+}
+
 int manager_add_job_by_name(Manager *m, JobType type, const char *name, JobMode mode, bool override, sd_bus_error *e, Job **_ret) {
         Unit *unit;
         int r;
@@ -1493,10 +1560,11 @@ unsigned manager_dispatch_load_queue(Manager *m) {
         return n;
 }
 
-int manager_load_unit_prepare(
+static int manager_load_unit_prepare_internal(
                 Manager *m,
                 const char *name,
                 const char *path,
+                bool defer,
                 sd_bus_error *e,
                 Unit **_ret) {
 
@@ -1528,6 +1596,15 @@ int manager_load_unit_prepare(
         ret = manager_get_unit(m, name);
         if (ret) {
                 *_ret = ret;
+
+                /* If so far the unit was only needed as ordering
+                 * target, now is the time to actually load it */
+                if (ret->load_deferred && !defer) {
+                        ret->load_deferred = false;
+                        unit_add_to_load_queue(ret);
+                        return 0;
+                }
+
                 return 1;
         }
 
@@ -1549,7 +1626,10 @@ int manager_load_unit_prepare(
                 return r;
         }
 
-        unit_add_to_load_queue(ret);
+        if (defer)
+                ret->load_deferred = true;
+        else
+                unit_add_to_load_queue(ret);
         unit_add_to_dbus_queue(ret);
         unit_add_to_gc_queue(ret);
 
@@ -1559,6 +1639,16 @@ int manager_load_unit_prepare(
         return 0;
 }
 
+int manager_load_unit_prepare(
+                Manager *m,
+                const char *name,
+                const char *path,
+                sd_bus_error *e,
+                Unit **_ret) {
+
+        return manager_load_unit_prepare_internal(m, name, path, false, e, _ret);
+}
+
 int manager_load_unit(
                 Manager *m,
                 const char *name,
@@ -1585,6 +1675,81 @@ int manager_load_unit(
         return 0;
 }
 
+static bool manager_may_defer_load(Manager *m, const char *name) {
+        char **p;
+
+        assert(m);
+        assert(name);
+
+        /* Loading a unit can only be postponed if doing so later
+         * cannot change what the unit is: it must not be an alias
+         * (i.e. a symlink) that would be merged into another unit
+         * once loaded, and its type must be configured exclusively
+         * from unit files. We rely on the unit path cache to find the
+         * file cheaply, hence this only applies while starting up or
+         * reloading, which is when the bulk of units is loaded. */
+
+        if (!m->unit_path_cache)
+                return false;
+
+        if (!IN_SET(unit_name_to_type(name), UNIT_SERVICE, UNIT_SOCKET, UNIT_TARGET, UNIT_TIMER, UNIT_PATH))
+                return false;
+
+        if (!unit_name_is_valid(name, UNIT_NAME_PLAIN))
+                return false;
+
+        STRV_FOREACH(p, m->lookup_paths.unit_path) {
+                _cleanup_free_ char *fn = NULL;
+                struct stat st;
+
+                fn = path_make_absolute(name, *p);
+                if (!fn)
+                        return false;
+
+                if (!set_get(m->unit_path_cache, fn))
+                        continue;
+
+                if (lstat(fn, &st) < 0)
+                        return false;
+
+                return S_ISREG(st.st_mode);
+        }
+
+        /* No unit file at all, loading it would merely mark it as
+         * not found */
+        return true;
+}
+
+int manager_load_unit_lazy(
+                Manager *m,
+                const char *name,
+                sd_bus_error *e,
+                Unit **_ret) {
+
+        Unit *u;
+
+        assert(m);
+        assert(name);
+
+        /* Like manager_load_unit(), but for units that are only
+         * referenced as ordering targets. Those only matter once they
+         * have a job or are queried explicitly, hence we just create a
+         * stub for them and defer parsing their configuration (and
+         * pulling in everything that references) until then. */
+
+        u = manager_get_unit(m, name);
+        if (u) {
+                if (_ret)
+                        *_ret = u;
+                return 1;
+        }
+
+        if (manager_may_defer_load(m, name))
+                return manager_load_unit_prepare_internal(m, name, NULL, true, e, _ret);
+
+        return manager_load_unit(m, name, NULL, e, _ret);
+}
+
 void manager_dump_jobs(Manager *s, FILE *f, const char *prefix) {
         Iterator i;
         Job *j;
@@ -1626,6 +1791,8 @@ static int manager_dispatch_run_queue(sd_event_source *source, void *userdata) {
         assert(source);
         assert(m);
 
+        condition_cache_begin();
+
         while ((j = m->run_queue)) {
                 assert(j->installed);
                 assert(j->in_run_queue);
@@ -1633,6 +1800,8 @@ static int manager_dispatch_run_queue(sd_event_source *source, void *userdata) {
                 job_run_and_invalidate(j);
         }
 
+        condition_cache_end();
+
         if (m->n_running_jobs > 0)
                 manager_watch_jobs_in_progress(m);
 
@@ -2588,6 +2757,10 @@ int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool switching_root) {
                 if (u->id != t)
                         continue;
 
+                /* Never loaded, nothing to save */
+                if (u->load_deferred)
+                        continue;
+
                 /* Start marker */
                 fputs(u->id, f);
                 fputc('\n', f);
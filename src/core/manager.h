@@ -195,10 +195,17 @@ struct Manager {
         int utab_inotify_fd;
         sd_event_source *mount_utab_event_source;
 
+        /* Data specific to the path subsystem */
+        int path_inotify_fd;
+        sd_event_source *path_inotify_event_source;
+        Hashmap *path_watches;
+        Set *path_specs_pending;
+
         /* Data specific to the swap filesystem */
         FILE *proc_swaps;
         sd_event_source *swap_event_source;
         Hashmap *swaps_by_devnode;
+        Hashmap *swaps_proc_entries;
 
         /* Data specific to the D-Bus subsystem */
         sd_bus *api_bus, *system_bus;
@@ -331,9 +338,11 @@ int manager_get_job_from_dbus_path(Manager *m, const char *s, Job **_j);
 
 int manager_load_unit_prepare(Manager *m, const char *name, const char *path, sd_bus_error *e, Unit **_ret);
 int manager_load_unit(Manager *m, const char *name, const char *path, sd_bus_error *e, Unit **_ret);
+int manager_load_unit_lazy(Manager *m, const char *name, sd_bus_error *e, Unit **_ret);
 int manager_load_unit_from_dbus_path(Manager *m, const char *s, sd_bus_error *e, Unit **_u);
 
 int manager_add_job(Manager *m, JobType type, Unit *unit, JobMode mode, bool force, sd_bus_error *e, Job **_ret);
+int manager_add_jobs(Manager *m, JobType type, Unit **units, unsigned n_units, JobMode mode, bool force, sd_bus_error *e);
 int manager_add_job_by_name(Manager *m, JobType type, const char *name, JobMode mode, bool force, sd_bus_error *e, Job **_ret);
 
 void manager_dump_units(Manager *s, FILE *f, const char *prefix);
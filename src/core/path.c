@@ -43,18 +43,237 @@ static const UnitActiveState state_translation_table[_PATH_STATE_MAX] = {
         [PATH_FAILED] = UNIT_FAILED
 };
 
-static int path_dispatch_io(sd_event_source *source, int fd, uint32_t revents, void *userdata);
+struct PathWatch {
+        Manager *manager;
+        int wd;
+        Set *specs;
+};
+
+static const int flags_table[_PATH_TYPE_MAX] = {
+        [PATH_EXISTS] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB,
+        [PATH_EXISTS_GLOB] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB,
+        [PATH_CHANGED] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB|IN_CLOSE_WRITE|IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO,
+        [PATH_MODIFIED] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB|IN_CLOSE_WRITE|IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_MODIFY,
+        [PATH_DIRECTORY_NOT_EMPTY] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB|IN_CREATE|IN_MOVED_TO
+};
+
+static void path_spec_event(PathSpec *s, bool changed);
+
+static int path_inotify_dispatch(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
+        Manager *m = userdata;
+        union inotify_event_buffer buffer;
+        struct inotify_event *e;
+        PathWatch *w;
+        PathSpec *s;
+        Iterator i, j;
+        ssize_t l;
+        int r;
 
-int path_spec_watch(PathSpec *s, sd_event_io_handler_t handler) {
+        assert(m);
+        assert(fd == m->path_inotify_fd);
 
-        static const int flags_table[_PATH_TYPE_MAX] = {
-                [PATH_EXISTS] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB,
-                [PATH_EXISTS_GLOB] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB,
-                [PATH_CHANGED] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB|IN_CLOSE_WRITE|IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO,
-                [PATH_MODIFIED] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB|IN_CLOSE_WRITE|IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_MODIFY,
-                [PATH_DIRECTORY_NOT_EMPTY] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB|IN_CREATE|IN_MOVED_TO
-        };
+        r = set_ensure_allocated(&m->path_specs_pending, NULL);
+        if (r < 0) {
+                log_oom();
+                return 0;
+        }
+
+        if (revents != EPOLLIN) {
+                log_error("Got invalid poll event on inotify.");
+
+                /* Don't keep polling the broken fd. Drop it together
+                 * with all watch descriptors on it, and have every
+                 * PathSpec recheck. That sets up new watches on a new
+                 * fd, or fails the unit like any failed watch does. */
+                m->path_inotify_event_source = sd_event_source_unref(m->path_inotify_event_source);
+                m->path_inotify_fd = safe_close(m->path_inotify_fd);
+
+                while ((w = hashmap_steal_first(m->path_watches))) {
+                        w->wd = -1;
+
+                        SET_FOREACH(s, w->specs, i)
+                                (void) set_put(m->path_specs_pending, s);
+                }
 
+                goto dispatch;
+        }
+
+        l = read(fd, &buffer, sizeof(buffer));
+        if (l < 0) {
+                if (errno == EAGAIN || errno == EINTR)
+                        return 0;
+
+                log_error_errno(errno, "Failed to read inotify event: %m");
+                return 0;
+        }
+
+        FOREACH_INOTIFY_EVENT(e, buffer, l) {
+
+                if (e->mask & IN_Q_OVERFLOW) {
+                        /* We lost events, recheck everything */
+                        HASHMAP_FOREACH(w, m->path_watches, i)
+                                SET_FOREACH(s, w->specs, j)
+                                        (void) set_put(m->path_specs_pending, s);
+                        continue;
+                }
+
+                w = hashmap_get(m->path_watches, INT_TO_PTR(e->wd));
+                if (!w)
+                        continue;
+
+                SET_FOREACH(s, w->specs, i) {
+                        if ((s->type == PATH_CHANGED || s->type == PATH_MODIFIED) &&
+                            s->primary_watch == w &&
+                            (e->mask & (flags_table[s->type]|IN_IGNORED)))
+                                s->changed = true;
+
+                        if (set_put(m->path_specs_pending, s) < 0)
+                                log_oom();
+                }
+
+                /* The watch is gone in the kernel, and the wd might
+                 * be reused. The PathSpecs keep the PathWatch around
+                 * until they are unwatched. */
+                if (e->mask & IN_IGNORED) {
+                        hashmap_remove(m->path_watches, INT_TO_PTR(w->wd));
+                        w->wd = -1;
+                }
+        }
+
+dispatch:
+        /* Now dispatch each PathSpec only once, however many events
+         * it got in this batch. Note that a handler might unwatch
+         * other PathSpecs, which removes them from the set again. */
+        while ((s = set_steal_first(m->path_specs_pending))) {
+                bool changed = s->changed;
+
+                s->changed = false;
+                s->handler(s, changed);
+        }
+
+        return 0;
+}
+
+static int path_inotify_open(Manager *m) {
+        int r;
+
+        assert(m);
+
+        if (m->path_inotify_fd >= 0)
+                return 0;
+
+        /* All PathSpecs share one inotify fd per manager, so that we
+         * don't run out of inotify instances with many path units */
+        m->path_inotify_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+        if (m->path_inotify_fd < 0)
+                return -errno;
+
+        r = sd_event_add_io(m->event, &m->path_inotify_event_source, m->path_inotify_fd, EPOLLIN, path_inotify_dispatch, m);
+        if (r < 0) {
+                m->path_inotify_fd = safe_close(m->path_inotify_fd);
+                return r;
+        }
+
+        return 0;
+}
+
+static void path_watch_remove_spec(PathWatch *w, PathSpec *s) {
+        Manager *m;
+
+        assert(w);
+        assert(s);
+
+        m = w->manager;
+
+        set_remove(w->specs, s);
+        if (!set_isempty(w->specs))
+                return;
+
+        if (w->wd >= 0) {
+                (void) inotify_rm_watch(m->path_inotify_fd, w->wd);
+                hashmap_remove(m->path_watches, INT_TO_PTR(w->wd));
+        }
+
+        set_free(w->specs);
+        free(w);
+}
+
+static int path_spec_add_watch(PathSpec *s, const char *path, uint32_t flags, PathWatch **ret) {
+        Manager *m;
+        PathWatch *w;
+        bool created = false;
+        int wd, r;
+
+        assert(s);
+        assert(path);
+
+        m = s->unit->manager;
+
+        /* Watches on the same inode share the watch descriptor, hence
+         * extend whatever was asked for on it before rather than
+         * replacing it. Spurious events only cause a recheck. */
+        wd = inotify_add_watch(m->path_inotify_fd, path, flags|IN_MASK_ADD);
+        if (wd < 0)
+                return -errno;
+
+        w = hashmap_get(m->path_watches, INT_TO_PTR(wd));
+        if (!w) {
+                r = hashmap_ensure_allocated(&m->path_watches, NULL);
+                if (r < 0)
+                        goto fail;
+
+                w = new0(PathWatch, 1);
+                if (!w) {
+                        r = -ENOMEM;
+                        goto fail;
+                }
+
+                w->manager = m;
+                w->wd = wd;
+
+                r = hashmap_put(m->path_watches, INT_TO_PTR(wd), w);
+                if (r < 0) {
+                        w = mfree(w);
+                        goto fail;
+                }
+
+                created = true;
+        }
+
+        r = set_ensure_allocated(&w->specs, NULL);
+        if (r < 0)
+                goto fail_watch;
+
+        if (!GREEDY_REALLOC(s->watches, s->n_watches_allocated, s->n_watches + 1)) {
+                r = -ENOMEM;
+                goto fail_watch;
+        }
+
+        r = set_put(w->specs, s);
+        if (r < 0)
+                goto fail_watch;
+        if (r > 0)
+                s->watches[s->n_watches++] = w;
+
+        if (ret)
+                *ret = w;
+
+        return 0;
+
+fail_watch:
+        if (created) {
+                hashmap_remove(m->path_watches, INT_TO_PTR(wd));
+                set_free(w->specs);
+                free(w);
+        }
+fail:
+        if (created || !w)
+                (void) inotify_rm_watch(m->path_inotify_fd, wd);
+
+        return r;
+}
+
+int path_spec_watch(PathSpec *s, PathSpecHandler handler) {
         bool exists = false;
         char *slash, *oldslash = NULL;
         int r;
@@ -65,19 +284,17 @@ int path_spec_watch(PathSpec *s, sd_event_io_handler_t handler) {
 
         path_spec_unwatch(s);
 
-        s->inotify_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
-        if (s->inotify_fd < 0) {
-                r = -errno;
-                goto fail;
-        }
+        s->handler = handler;
+        s->changed = false;
 
-        r = sd_event_add_io(s->unit->manager->event, &s->event_source, s->inotify_fd, EPOLLIN, handler, s);
+        r = path_inotify_open(s->unit->manager);
         if (r < 0)
                 goto fail;
 
         /* This assumes the path was passed through path_kill_slashes()! */
 
         for (slash = strchr(s->path, '/'); ; slash = strchr(slash+1, '/')) {
+                PathWatch *w = NULL;
                 char *cut = NULL;
                 int flags;
                 char tmp;
@@ -91,17 +308,16 @@ int path_spec_watch(PathSpec *s, sd_event_io_handler_t handler) {
                 } else
                         flags = flags_table[s->type];
 
-                r = inotify_add_watch(s->inotify_fd, s->path, flags);
+                r = path_spec_add_watch(s, s->path, flags, &w);
                 if (r < 0) {
-                        if (errno == EACCES || errno == ENOENT) {
+                        if (r == -EACCES || r == -ENOENT) {
                                 if (cut)
                                         *cut = tmp;
                                 break;
                         }
 
                         log_warning("Failed to add watch on %s: %s", s->path,
-                                    errno == ENOSPC ? "too many watches" : strerror(-r));
-                        r = -errno;
+                                    r == -ENOSPC ? "too many watches" : strerror(-r));
                         if (cut)
                                 *cut = tmp;
                         goto fail;
@@ -115,7 +331,7 @@ int path_spec_watch(PathSpec *s, sd_event_io_handler_t handler) {
                                 char tmp2 = *cut2;
                                 *cut2 = '\0';
 
-                                inotify_add_watch(s->inotify_fd, s->path, IN_MOVE_SELF);
+                                (void) path_spec_add_watch(s, s->path, IN_MOVE_SELF, NULL);
                                 /* Error is ignored, the worst can happen is
                                    we get spurious events. */
 
@@ -130,16 +346,15 @@ int path_spec_watch(PathSpec *s, sd_event_io_handler_t handler) {
                         oldslash = slash;
                 else {
                         /* whole path has been iterated over */
-                        s->primary_wd = r;
+                        s->primary_watch = w;
                         break;
                 }
         }
 
         if (!exists) {
-                log_error_errno(errno, "Failed to add watch on any of the components of %s: %m",
+                log_error_errno(r, "Failed to add watch on any of the components of %s: %m",
                           s->path);
-                r = -errno; /* either EACCESS or ENOENT */
-                goto fail;
+                goto fail; /* either EACCESS or ENOENT */
         }
 
         return 0;
@@ -150,38 +365,19 @@ fail:
 }
 
 void path_spec_unwatch(PathSpec *s) {
-        assert(s);
-
-        s->event_source = sd_event_source_unref(s->event_source);
-        s->inotify_fd = safe_close(s->inotify_fd);
-}
-
-int path_spec_fd_event(PathSpec *s, uint32_t revents) {
-        union inotify_event_buffer buffer;
-        struct inotify_event *e;
-        ssize_t l;
-        int r = 0;
+        size_t i;
 
-        if (revents != EPOLLIN) {
-                log_error("Got invalid poll event on inotify.");
-                return -EINVAL;
-        }
-
-        l = read(s->inotify_fd, &buffer, sizeof(buffer));
-        if (l < 0) {
-                if (errno == EAGAIN || errno == EINTR)
-                        return 0;
+        assert(s);
 
-                return log_error_errno(errno, "Failed to read inotify event: %m");
-        }
+        for (i = 0; i < s->n_watches; i++)
+                path_watch_remove_spec(s->watches[i], s);
 
-        FOREACH_INOTIFY_EVENT(e, buffer, l) {
-                if ((s->type == PATH_CHANGED || s->type == PATH_MODIFIED) &&
-                    s->primary_wd == e->wd)
-                        r = 1;
-        }
+        s->watches = mfree(s->watches);
+        s->n_watches = s->n_watches_allocated = 0;
+        s->primary_watch = NULL;
 
-        return r;
+        if (s->unit)
+                set_remove(s->unit->manager->path_specs_pending, s);
 }
 
 static bool path_spec_check_good(PathSpec *s, bool initial) {
@@ -243,7 +439,7 @@ static void path_spec_dump(PathSpec *s, FILE *f, const char *prefix) {
 
 void path_spec_done(PathSpec *s) {
         assert(s);
-        assert(s->inotify_fd == -1);
+        assert(s->n_watches == 0);
 
         free(s->path);
 }
@@ -410,7 +606,7 @@ static int path_watch(Path *p) {
         assert(p);
 
         LIST_FOREACH(spec, s, p->specs) {
-                r = path_spec_watch(s, path_dispatch_io);
+                r = path_spec_watch(s, path_spec_event);
                 if (r < 0)
                         return r;
         }
@@ -658,36 +854,28 @@ _pure_ static const char *path_sub_state_to_string(Unit *u) {
         return path_state_to_string(PATH(u)->state);
 }
 
-static int path_dispatch_io(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
-        PathSpec *s = userdata;
+static void path_spec_event(PathSpec *s, bool changed) {
+        PathSpec *t;
         Path *p;
-        int changed;
 
         assert(s);
         assert(s->unit);
-        assert(fd >= 0);
 
         p = PATH(s->unit);
 
+        /* Pick up changes the other specs of this unit saw in the
+         * same batch, since dealing with this one rewatches them. */
+        LIST_FOREACH(spec, t, p->specs) {
+                changed = changed || t->changed;
+                t->changed = false;
+        }
+
         if (p->state != PATH_WAITING &&
             p->state != PATH_RUNNING)
-                return 0;
+                return;
 
         /* log_debug("inotify wakeup on %s.", u->id); */
 
-        LIST_FOREACH(spec, s, p->specs)
-                if (path_spec_owns_inotify_fd(s, fd))
-                        break;
-
-        if (!s) {
-                log_error("Got event on unknown fd.");
-                goto fail;
-        }
-
-        changed = path_spec_fd_event(s, revents);
-        if (changed < 0)
-                goto fail;
-
         /* If we are already running, then remember that one event was
          * dispatched so that we restart the service only if something
          * actually changed on disk */
@@ -697,12 +885,6 @@ static int path_dispatch_io(sd_event_source *source, int fd, uint32_t revents, v
                 path_enter_running(p);
         else
                 path_enter_waiting(p, false, true);
-
-        return 0;
-
-fail:
-        path_enter_dead(p, PATH_FAILURE_RESOURCES);
-        return 0;
 }
 
 static void path_trigger_notify(Unit *u, Unit *other) {
@@ -730,6 +912,20 @@ static void path_trigger_notify(Unit *u, Unit *other) {
         }
 }
 
+static void path_shutdown(Manager *m) {
+        assert(m);
+
+        m->path_inotify_event_source = sd_event_source_unref(m->path_inotify_event_source);
+        m->path_inotify_fd = safe_close(m->path_inotify_fd);
+
+        /* All PathSpecs have been unwatched by now */
+        assert(hashmap_isempty(m->path_watches));
+        hashmap_free(m->path_watches);
+        m->path_watches = NULL;
+        set_free(m->path_specs_pending);
+        m->path_specs_pending = NULL;
+}
+
 static void path_reset_failed(Unit *u) {
         Path *p = PATH(u);
 
@@ -777,6 +973,7 @@ const UnitVTable path_vtable = {
 
         .init = path_init,
         .done = path_done,
+        .shutdown = path_shutdown,
         .load = path_load,
 
         .coldplug = path_coldplug,
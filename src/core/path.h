@@ -46,31 +46,38 @@ typedef enum PathType {
         _PATH_TYPE_INVALID = -1
 } PathType;
 
+typedef struct PathWatch PathWatch;
+
+/* Called once for each batch of inotify events concerning the
+ * PathSpec. 'changed' is set if the watched path itself was changed
+ * in the sense of PathChanged=/PathModified=. */
+typedef void (*PathSpecHandler)(PathSpec *s, bool changed);
+
 typedef struct PathSpec {
         Unit *unit;
 
         char *path;
 
-        sd_event_source *event_source;
+        PathSpecHandler handler;
+
+        /* The shared watches on the path and its parents, see
+         * path_spec_watch() */
+        PathWatch **watches;
+        size_t n_watches, n_watches_allocated;
+        PathWatch *primary_watch;
 
         LIST_FIELDS(struct PathSpec, spec);
 
         PathType type;
-        int inotify_fd;
-        int primary_wd;
 
         bool previous_exists;
+        bool changed;
 } PathSpec;
 
-int path_spec_watch(PathSpec *s, sd_event_io_handler_t handler);
+int path_spec_watch(PathSpec *s, PathSpecHandler handler);
 void path_spec_unwatch(PathSpec *s);
-int path_spec_fd_event(PathSpec *s, uint32_t events);
 void path_spec_done(PathSpec *s);
 
-static inline bool path_spec_owns_inotify_fd(PathSpec *s, int fd) {
-        return s->inotify_fd == fd;
-}
-
 typedef enum PathResult {
         PATH_SUCCESS,
         PATH_FAILURE_RESOURCES,
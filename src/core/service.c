@@ -87,7 +87,7 @@ static const UnitActiveState state_translation_table_idle[_SERVICE_STATE_MAX] =
         [SERVICE_AUTO_RESTART] = UNIT_ACTIVATING
 };
 
-static int service_dispatch_io(sd_event_source *source, int fd, uint32_t events, void *userdata);
+static void service_dispatch_pid_file(PathSpec *p, bool changed);
 static int service_dispatch_timer(sd_event_source *source, usec_t usec, void *userdata);
 static int service_dispatch_watchdog(sd_event_source *source, usec_t usec, void *userdata);
 
@@ -232,9 +232,24 @@ static void service_start_watchdog(Service *s) {
 }
 
 static void service_reset_watchdog(Service *s) {
+        int enabled;
+
         assert(s);
 
         dual_timestamp_get(&s->watchdog_timestamp);
+
+        /* If the timer is armed already we leave it alone, and only
+         * move the deadline. service_dispatch_watchdog() checks it
+         * when the timer elapses and rearms the timer if the service
+         * pinged us in the meantime. That way keep-alive messages,
+         * which might come in much more often than the watchdog
+         * timeout, don't reshuffle the event loop's timer queue each
+         * time. */
+        if (s->watchdog_event_source &&
+            sd_event_source_get_enabled(s->watchdog_event_source, &enabled) >= 0 &&
+            enabled != SD_EVENT_OFF)
+                return;
+
         service_start_watchdog(s);
 }
 
@@ -2489,7 +2504,7 @@ static int service_watch_pid_file(Service *s) {
 
         log_unit_debug(UNIT(s)->id, "Setting watch for %s's PID file %s", UNIT(s)->id, s->pid_file_pathspec->path);
 
-        r = path_spec_watch(s->pid_file_pathspec, service_dispatch_io);
+        r = path_spec_watch(s->pid_file_pathspec, service_dispatch_pid_file);
         if (r < 0)
                 goto fail;
 
@@ -2526,15 +2541,13 @@ static int service_demand_pid_file(Service *s) {
         /* PATH_CHANGED would not be enough. There are daemons (sendmail) that
          * keep their PID file open all the time. */
         ps->type = PATH_MODIFIED;
-        ps->inotify_fd = -1;
 
         s->pid_file_pathspec = ps;
 
         return service_watch_pid_file(s);
 }
 
-static int service_dispatch_io(sd_event_source *source, int fd, uint32_t events, void *userdata) {
-        PathSpec *p = userdata;
+static void service_dispatch_pid_file(PathSpec *p, bool changed) {
         Service *s;
 
         assert(p);
@@ -2542,28 +2555,22 @@ static int service_dispatch_io(sd_event_source *source, int fd, uint32_t events,
         s = SERVICE(p->unit);
 
         assert(s);
-        assert(fd >= 0);
         assert(s->state == SERVICE_START || s->state == SERVICE_START_POST);
-        assert(s->pid_file_pathspec);
-        assert(path_spec_owns_inotify_fd(s->pid_file_pathspec, fd));
+        assert(s->pid_file_pathspec == p);
 
         log_unit_debug(UNIT(s)->id, "inotify event for %s", UNIT(s)->id);
 
-        if (path_spec_fd_event(p, events) < 0)
-                goto fail;
-
         if (service_retry_pid_file(s) == 0)
-                return 0;
+                return;
 
         if (service_watch_pid_file(s) < 0)
                 goto fail;
 
-        return 0;
+        return;
 
 fail:
         service_unwatch_pid_file(s);
         service_enter_signal(s, SERVICE_STOP_SIGTERM, SERVICE_FAILURE_RESOURCES);
-        return 0;
 }
 
 static void service_notify_cgroup_empty_event(Unit *u) {
@@ -3042,6 +3049,13 @@ static int service_dispatch_watchdog(sd_event_source *source, usec_t usec, void
         assert(s);
         assert(source == s->watchdog_event_source);
 
+        /* Got pinged since the timer was armed? Then wait for the
+         * new deadline, see service_reset_watchdog() */
+        if (s->watchdog_timestamp.monotonic + s->watchdog_usec > usec) {
+                service_start_watchdog(s);
+                return 0;
+        }
+
         log_unit_error(UNIT(s)->id, "%s watchdog timeout (limit %s)!", UNIT(s)->id,
                        format_timespan(t, sizeof(t), s->watchdog_usec, 1));
 
@@ -1078,12 +1078,31 @@ static int swap_dispatch_timer(sd_event_source *source, usec_t usec, void *userd
         return 0;
 }
 
+static void swap_proc_entries_free(Hashmap *h) {
+        char *d;
+
+        while ((d = hashmap_steal_first_key(h)))
+                free(d);
+
+        hashmap_free(h);
+}
+
 static int swap_load_proc_swaps(Manager *m, bool set_flags) {
+        Hashmap *entries;
         unsigned i;
         int r = 0;
 
         assert(m);
 
+        /* Remember device and priority of each entry, keyed by
+         * device. If we are just catching up with a change, entries
+         * that are unchanged since the last time don't need their
+         * device links looked up again, swap_dispatch_io() flags
+         * their units as active. */
+        entries = hashmap_new(&string_hash_ops);
+        if (!entries)
+                return log_oom();
+
         rewind(m->proc_swaps);
 
         (void) fscanf(m->proc_swaps, "%*s %*s %*s %*s %*s\n");
@@ -1108,16 +1127,32 @@ static int swap_load_proc_swaps(Manager *m, bool set_flags) {
                 }
 
                 d = cunescape(dev);
-                if (!d)
-                        return log_oom();
+                if (!d) {
+                        r = log_oom();
+                        goto finish;
+                }
 
-                device_found_node(m, d, true, DEVICE_FOUND_SWAP, set_flags);
+                if (set_flags &&
+                    hashmap_contains(m->swaps_proc_entries, d) &&
+                    PTR_TO_INT(hashmap_get(m->swaps_proc_entries, d)) == prio) {
+                        k = 0;
+                } else {
+                        device_found_node(m, d, true, DEVICE_FOUND_SWAP, set_flags);
+
+                        k = swap_process_new(m, d, prio, set_flags);
+                        if (k < 0)
+                                r = k;
+                }
 
-                k = swap_process_new(m, d, prio, set_flags);
-                if (k < 0)
-                        r = k;
+                /* If setting up the units failed, try again next time */
+                if (k >= 0 && hashmap_put(entries, d, INT_TO_PTR(prio)) > 0)
+                        d = NULL;
         }
 
+finish:
+        swap_proc_entries_free(m->swaps_proc_entries);
+        m->swaps_proc_entries = entries;
+
         return r;
 }
 
@@ -1133,6 +1168,10 @@ static int swap_dispatch_io(sd_event_source *source, int fd, uint32_t revents, v
         if (r < 0) {
                 log_error_errno(r, "Failed to reread /proc/swaps: %m");
 
+                /* Start from scratch next time */
+                swap_proc_entries_free(m->swaps_proc_entries);
+                m->swaps_proc_entries = NULL;
+
                 /* Reset flags, just in case, for late calls */
                 LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_SWAP]) {
                         Swap *swap = SWAP(u);
@@ -1148,6 +1187,12 @@ static int swap_dispatch_io(sd_event_source *source, int fd, uint32_t revents, v
         LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_SWAP]) {
                 Swap *swap = SWAP(u);
 
+                /* Still there and unchanged, see swap_load_proc_swaps() */
+                if (!swap->is_active &&
+                    swap->from_proc_swaps &&
+                    hashmap_contains(m->swaps_proc_entries, swap->parameters_proc_swaps.what))
+                        swap->is_active = true;
+
                 if (!swap->is_active) {
                         /* This has just been deactivated */
 
@@ -1280,6 +1325,9 @@ static void swap_shutdown(Manager *m) {
 
         hashmap_free(m->swaps_by_devnode);
         m->swaps_by_devnode = NULL;
+
+        swap_proc_entries_free(m->swaps_proc_entries);
+        m->swaps_proc_entries = NULL;
 }
 
 static int swap_enumerate(Manager *m) {
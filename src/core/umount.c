@@ -24,6 +24,7 @@
 #include <string.h>
 #include <sys/mount.h>
 #include <sys/swap.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <linux/loop.h>
 #include <linux/dm-ioctl.h>
@@ -44,8 +45,17 @@ typedef struct MountPoint {
         char *type;
         dev_t devnum;
         LIST_FIELDS(struct MountPoint, mount_point);
+
+        /* Used while unmounting */
+        struct MountPoint *parent;
+        unsigned n_children;
+        pid_t pid;
+        usec_t deadline;
 } MountPoint;
 
+/* How many umount children to run in parallel during shutdown */
+#define UMOUNT_WORKERS_MAX 16
+
 static void mount_point_free(MountPoint **head, MountPoint *m) {
         assert(head);
         assert(m);
@@ -254,6 +264,7 @@ static int loopback_list_get(MountPoint **head) {
                 }
 
                 lb->path = loop;
+                lb->devnum = udev_device_get_devnum(d);
                 LIST_PREPEND(mount_point, *head, lb);
         }
 
@@ -363,56 +374,97 @@ static int delete_dm(dev_t devnum) {
         return r >= 0 ? 0 : -errno;
 }
 
-static int remount_with_timeout(MountPoint *m, char *options, int *n_failed) {
-        pid_t pid;
-        int r;
-
-        BLOCK_SIGNALS(SIGCHLD);
+static bool mount_point_keep(MountPoint *m) {
+        assert(m);
 
-        /* Due to the possiblity of a remount operation hanging, we
-         * fork a child process and set a timeout. If the timeout
-         * lapses, the assumption is that that particular remount
-         * failed. */
-        pid = fork();
-        if (pid < 0)
-                return log_error_errno(errno, "Failed to fork: %m");
+        /* Skip / and /usr since we cannot unmount that anyway, since
+         * we are running from it. They are only remounted ro. */
+        return path_equal(m->path, "/")
+#ifndef HAVE_SPLIT_USR
+                || path_equal(m->path, "/usr")
+#endif
+                ;
+}
 
-        if (pid == 0) {
-                log_info("Remounting '%s' read-only in with options '%s'.", m->path, options);
+static void mount_points_list_build_tree(MountPoint **head) {
+        MountPoint *m, *p;
 
-                /* Start the mount operation here in the child */
-                r = mount(NULL, m->path, NULL, MS_REMOUNT|MS_RDONLY, options);
-                if (r < 0)
-                        log_error_errno(errno, "Failed to remount '%s' read-only: %m", m->path);
+        assert(head);
 
-                _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+        LIST_FOREACH(mount_point, m, *head) {
+                m->parent = NULL;
+                m->n_children = 0;
         }
 
-        r = wait_for_terminate_with_timeout(pid, DEFAULT_TIMEOUT_USEC);
-        if (r == -ETIMEDOUT) {
-                log_error_errno(errno, "Remounting '%s' - timed out, issuing SIGKILL to PID "PID_FMT".", m->path, pid);
-                (void) kill(pid, SIGKILL);
-        } else if (r < 0)
-                log_error_errno(r, "Failed to wait for process: %m");
+        /* Attach every mount point to the closest mount point it is
+         * located beneath, so that it is taken care of before that
+         * one. Mount points stacked on the same path are attached to
+         * the one they are stacked on, which is the next one with the
+         * same path in the list, since the list is in reverse order of
+         * /proc/self/mountinfo. */
+        LIST_FOREACH(mount_point, m, *head) {
+                bool after = false;
+
+                LIST_FOREACH(mount_point, p, *head) {
+                        if (p == m) {
+                                after = true;
+                                continue;
+                        }
 
-        return r;
+                        if (path_equal(p->path, m->path)) {
+                                if (!after)
+                                        continue;
+                        } else if (!path_startswith(m->path, p->path))
+                                continue;
+
+                        if (!m->parent || strlen(p->path) > strlen(m->parent->path))
+                                m->parent = p;
+                }
+
+                if (m->parent)
+                        m->parent->n_children++;
+        }
 }
 
-static int umount_with_timeout(MountPoint *m, bool *changed) {
+static int mount_point_spawn(MountPoint *m, bool remount, pid_t *ret) {
         pid_t pid;
-        int r;
 
-        BLOCK_SIGNALS(SIGCHLD);
+        assert(m);
+        assert(ret);
 
-        /* Due to the possiblity of a umount operation hanging, we
-         * fork a child process and set a timeout. If the timeout
-         * lapses, the assumption is that that particular umount
-         * failed. */
+        /* Due to the possiblity of a remount or umount operation
+         * hanging, we do them in a child process, which is killed if
+         * the deadline lapses. The assumption is then that the
+         * particular operation failed. */
         pid = fork();
         if (pid < 0)
                 return log_error_errno(errno, "Failed to fork: %m");
 
         if (pid == 0) {
+                if (remount) {
+                        _cleanup_free_ char *options = NULL;
+
+                        /* MS_REMOUNT requires that the data parameter
+                         * should be the same from the original mount
+                         * except for the desired changes. Since we want
+                         * to remount read-only, we should filter out
+                         * rw (and ro too, because it confuses the kernel) */
+                        (void) fstab_filter_options(m->options, "rw\0ro\0", NULL, NULL, &options);
+
+                        log_info("Remounting '%s' read-only in with options '%s'.", m->path, options);
+
+                        /* Since the remount can hang in the instance of
+                         * remote filesystems, we skip the subsequent
+                         * umount if it fails */
+                        if (mount(NULL, m->path, NULL, MS_REMOUNT|MS_RDONLY, options) < 0) {
+                                log_error_errno(errno, "Failed to remount '%s' read-only: %m", m->path);
+                                _exit(EXIT_FAILURE);
+                        }
+                }
+
+                if (mount_point_keep(m))
+                        _exit(EXIT_SUCCESS);
+
                 log_info("Unmounting '%s'.", m->path);
 
                 /* Start the mount operation here in the child Using MNT_FORCE
@@ -422,50 +474,87 @@ static int umount_with_timeout(MountPoint *m, bool *changed) {
                  * "busy", this may allow processes to die, thus making the
                  * filesystem less busy so the unmount might succeed (rather
                  * then return EBUSY).*/
-                r = umount2(m->path, MNT_FORCE);
-                if (r < 0)
+                if (umount2(m->path, MNT_FORCE) < 0) {
                         log_error_errno(errno, "Failed to unmount %s: %m", m->path);
+                        _exit(EXIT_FAILURE);
+                }
 
-                _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+                _exit(EXIT_SUCCESS);
         }
 
-        r = wait_for_terminate_with_timeout(pid, DEFAULT_TIMEOUT_USEC);
-        if (r == -ETIMEDOUT) {
-                log_error_errno(errno, "Unmounting '%s' - timed out, issuing SIGKILL to PID "PID_FMT".", m->path, pid);
-                (void) kill(pid, SIGKILL);
-        } else if (r < 0)
-                log_error_errno(r, "Failed to wait for process: %m");
-
-        return r;
+        *ret = pid;
+        return 0;
 }
 
+static void mount_point_done(MountPoint **head, MountPoint *m, bool success,
+                             MountPoint **ready, unsigned *n_ready,
+                             int *n_failed, bool *changed) {
+        assert(head);
+        assert(m);
+
+        /* Once everything beneath it is done, the parent may go */
+        if (m->parent && --m->parent->n_children == 0)
+                ready[(*n_ready)++] = m->parent;
+
+        if (mount_point_keep(m))
+                return;
+
+        if (!success)
+                (*n_failed)++;
+        else {
+                if (changed)
+                        *changed = true;
+
+                mount_point_free(head, m);
+        }
+}
 
 static int mount_points_list_umount(MountPoint **head, bool *changed) {
-        MountPoint *m, *n;
+        MountPoint *running[UMOUNT_WORKERS_MAX] = {};
+        _cleanup_free_ MountPoint **ready = NULL;
+        unsigned n_ready = 0, n_running = 0, n = 0, i;
+        bool remount;
+        MountPoint *m;
+        sigset_t mask;
         int n_failed = 0;
 
         assert(head);
 
-        LIST_FOREACH_SAFE(mount_point, m, n, *head) {
+        BLOCK_SIGNALS(SIGCHLD);
 
-                /* If we are in a container, don't attempt to
-                   read-only mount anything as that brings no real
-                   benefits, but might confuse the host, as we remount
-                   the superblock here, not the bind mount.
-                   If the filesystem is a network fs, also skip the
-                   remount.  It brings no value (we cannot leave
-                   a "dirty fs") and could hang if the network is down.
-                   Note that umount2() is more careful and will not
-                   hang because of the network being down. */
-                if (detect_container(NULL) <= 0 &&
-                    !fstype_is_network(m->type)) {
-                        _cleanup_free_ char *options = NULL;
-                        /* MS_REMOUNT requires that the data parameter
-                         * should be the same from the original mount
-                         * except for the desired changes. Since we want
-                         * to remount read-only, we should filter out
-                         * rw (and ro too, because it confuses the kernel) */
-                        (void) fstab_filter_options(m->options, "rw\0ro\0", NULL, NULL, &options);
+        assert_se(sigemptyset(&mask) == 0);
+        assert_se(sigaddset(&mask, SIGCHLD) == 0);
+
+        /* If we are in a container, don't attempt to
+           read-only mount anything as that brings no real
+           benefits, but might confuse the host, as we remount
+           the superblock here, not the bind mount. */
+        remount = detect_container(NULL) <= 0;
+
+        /* Mount points are taken care of as soon as everything
+         * mounted beneath them is, so that independent subtrees are
+         * unmounted in parallel, with at most UMOUNT_WORKERS_MAX
+         * children in flight. Each child gets its own deadline, and
+         * one that times out counts as failed, so that the mount
+         * points it is beneath still get their turn. */
+        mount_points_list_build_tree(head);
+
+        LIST_FOREACH(mount_point, m, *head)
+                n++;
+
+        ready = new(MountPoint*, n);
+        if (!ready)
+                return log_oom();
+
+        LIST_FOREACH(mount_point, m, *head)
+                if (m->n_children == 0)
+                        ready[n_ready++] = m;
+
+        for (;;) {
+                siginfo_t si = {};
+
+                while (n_ready > 0 && n_running < UMOUNT_WORKERS_MAX) {
+                        m = ready[--n_ready];
 
                         /* We always try to remount directories
                          * read-only first, before we go on and umount
@@ -484,32 +573,88 @@ static int mount_points_list_umount(MountPoint **head, bool *changed) {
                          * relatively safe regarding keeping the fs we
                          * can otherwise not see dirty.
                          *
-                         * Since the remount can hang in the instance of
-                         * remote filesystems, we remount asynchronously
-                         * and skip the subsequent umount if it fails */
-                        if (remount_with_timeout(m, options, &n_failed) < 0)
+                         * If the filesystem is a network fs, skip the
+                         * remount. It brings no value (we cannot leave
+                         * a "dirty fs") and could hang if the network
+                         * is down. Note that umount2() is more careful
+                         * and will not hang because of the network
+                         * being down. */
+                        if (mount_point_spawn(m, remount && !fstype_is_network(m->type), &m->pid) < 0) {
+                                mount_point_done(head, m, false, ready, &n_ready, &n_failed, changed);
                                 continue;
+                        }
+
+                        m->deadline = now(CLOCK_MONOTONIC) + DEFAULT_TIMEOUT_USEC;
+                        running[n_running++] = m;
                 }
 
-                /* Skip / and /usr since we cannot unmount that
-                 * anyway, since we are running from it. They have
-                 * already been remounted ro. */
-                if (path_equal(m->path, "/")
-#ifndef HAVE_SPLIT_USR
-                    || path_equal(m->path, "/usr")
-#endif
-                )
+                if (n_ready == 0 && n_running == 0)
+                        break;
+
+                if (waitid(P_ALL, 0, &si, WEXITED|WNOHANG) < 0) {
+                        if (errno == EINTR)
+                                continue;
+
+                        /* We cannot tell when the children are
+                         * done, hence give up on them right away, so
+                         * that the remaining mount points are at
+                         * least accounted for. */
+                        log_error_errno(errno, "Failed to wait for process: %m");
+
+                        while (n_running > 0) {
+                                m = running[--n_running];
+                                (void) kill(m->pid, SIGKILL);
+                                mount_point_done(head, m, false, ready, &n_ready, &n_failed, changed);
+                        }
+
                         continue;
+                }
 
-                /* Trying to umount */
-                if (umount_with_timeout(m, changed) < 0)
-                        n_failed++;
-                else {
-                        if (changed)
-                                *changed = true;
+                if (si.si_pid == 0) {
+                        struct timespec ts;
+                        usec_t t, next = USEC_INFINITY;
+                        bool expired = false;
 
-                        mount_point_free(head, m);
+                        t = now(CLOCK_MONOTONIC);
+
+                        for (i = 0; i < n_running;) {
+                                m = running[i];
+
+                                if (t < m->deadline) {
+                                        next = MIN(next, m->deadline);
+                                        i++;
+                                        continue;
+                                }
+
+                                log_error("Unmounting '%s' - timed out, issuing SIGKILL to PID "PID_FMT".",
+                                          m->path, m->pid);
+                                (void) kill(m->pid, SIGKILL);
+
+                                running[i] = running[--n_running];
+                                mount_point_done(head, m, false, ready, &n_ready, &n_failed, changed);
+                                expired = true;
+                        }
+
+                        if (!expired)
+                                (void) sigtimedwait(&mask, NULL, timespec_store(&ts, next - t));
+
+                        continue;
                 }
+
+                /* Children of earlier runs that timed out, and
+                 * anything else we are the parent of, are reaped too,
+                 * but otherwise ignored. */
+                for (i = 0; i < n_running; i++)
+                        if (running[i]->pid == si.si_pid)
+                                break;
+                if (i >= n_running)
+                        continue;
+
+                m = running[i];
+                running[i] = running[--n_running];
+
+                mount_point_done(head, m, si.si_code == CLD_EXITED && si.si_status == EXIT_SUCCESS,
+                                 ready, &n_ready, &n_failed, changed);
         }
 
         return n_failed;
@@ -537,38 +682,72 @@ static int swap_points_list_off(MountPoint **head, bool *changed) {
         return n_failed;
 }
 
+static bool block_device_is_held(dev_t devnum) {
+        char p[sizeof("/sys/dev/block/:/holders") + 2 * DECIMAL_STR_MAX(unsigned)];
+
+        if (major(devnum) == 0)
+                return false;
+
+        xsprintf(p, "/sys/dev/block/%u:%u/holders", major(devnum), minor(devnum));
+
+        return dir_is_empty(p) == 0;
+}
+
 static int loopback_points_list_detach(MountPoint **head, bool *changed) {
         MountPoint *m, *n;
-        int n_failed = 0, k;
+        int n_failed, k;
         struct stat root_st;
+        bool final = false;
 
         assert(head);
 
         k = lstat("/", &root_st);
 
-        LIST_FOREACH_SAFE(mount_point, m, n, *head) {
-                int r;
-                struct stat loopback_st;
-
-                if (k >= 0 &&
-                    major(root_st.st_dev) != 0 &&
-                    lstat(m->path, &loopback_st) >= 0 &&
-                    root_st.st_dev == loopback_st.st_rdev) {
-                        n_failed ++;
-                        continue;
-                }
+        /* Devices other block devices are still stacked on are left
+         * for later, so that they become free within this pass once
+         * their holders are gone, instead of on the next retry. If
+         * that stops making progress, everything left is tried. */
+        for (;;) {
+                bool progress = false, deferred = false;
 
-                log_info("Detaching loopback %s.", m->path);
-                r = delete_loopback(m->path);
-                if (r >= 0) {
-                        if (r > 0 && changed)
-                                *changed = true;
+                n_failed = 0;
 
-                        mount_point_free(head, m);
-                } else {
-                        log_warning_errno(errno, "Could not detach loopback %s: %m", m->path);
-                        n_failed++;
+                LIST_FOREACH_SAFE(mount_point, m, n, *head) {
+                        int r;
+                        struct stat loopback_st;
+
+                        if (k >= 0 &&
+                            major(root_st.st_dev) != 0 &&
+                            lstat(m->path, &loopback_st) >= 0 &&
+                            root_st.st_dev == loopback_st.st_rdev) {
+                                n_failed ++;
+                                continue;
+                        }
+
+                        if (!final && block_device_is_held(m->devnum)) {
+                                deferred = true;
+                                continue;
+                        }
+
+                        log_info("Detaching loopback %s.", m->path);
+                        r = delete_loopback(m->path);
+                        if (r >= 0) {
+                                if (r > 0 && changed)
+                                        *changed = true;
+
+                                progress = true;
+                                mount_point_free(head, m);
+                        } else {
+                                log_warning_errno(errno, "Could not detach loopback %s: %m", m->path);
+                                n_failed++;
+                        }
                 }
+
+                if (!deferred)
+                        break;
+
+                if (!progress)
+                        final = true;
         }
 
         return n_failed;
@@ -576,34 +755,54 @@ static int loopback_points_list_detach(MountPoint **head, bool *changed) {
 
 static int dm_points_list_detach(MountPoint **head, bool *changed) {
         MountPoint *m, *n;
-        int n_failed = 0, k;
+        int n_failed, k;
         struct stat root_st;
+        bool final = false;
 
         assert(head);
 
         k = lstat("/", &root_st);
 
-        LIST_FOREACH_SAFE(mount_point, m, n, *head) {
-                int r;
+        /* Same as above: detach the top of DM stacks first */
+        for (;;) {
+                bool progress = false, deferred = false;
 
-                if (k >= 0 &&
-                    major(root_st.st_dev) != 0 &&
-                    root_st.st_dev == m->devnum) {
-                        n_failed ++;
-                        continue;
-                }
+                n_failed = 0;
 
-                log_info("Detaching DM %u:%u.", major(m->devnum), minor(m->devnum));
-                r = delete_dm(m->devnum);
-                if (r >= 0) {
-                        if (changed)
-                                *changed = true;
+                LIST_FOREACH_SAFE(mount_point, m, n, *head) {
+                        int r;
 
-                        mount_point_free(head, m);
-                } else {
-                        log_warning_errno(errno, "Could not detach DM %s: %m", m->path);
-                        n_failed++;
+                        if (k >= 0 &&
+                            major(root_st.st_dev) != 0 &&
+                            root_st.st_dev == m->devnum) {
+                                n_failed ++;
+                                continue;
+                        }
+
+                        if (!final && block_device_is_held(m->devnum)) {
+                                deferred = true;
+                                continue;
+                        }
+
+                        log_info("Detaching DM %u:%u.", major(m->devnum), minor(m->devnum));
+                        r = delete_dm(m->devnum);
+                        if (r >= 0) {
+                                if (changed)
+                                        *changed = true;
+
+                                progress = true;
+                                mount_point_free(head, m);
+                        } else {
+                                log_warning_errno(errno, "Could not detach DM %s: %m", m->path);
+                                n_failed++;
+                        }
                 }
+
+                if (!deferred)
+                        break;
+
+                if (!progress)
+                        final = true;
         }
 
         return n_failed;
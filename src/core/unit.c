@@ -2407,7 +2407,11 @@ int unit_add_dependency_by_name(Unit *u, UnitDependency d, const char *name, con
         if (!name)
                 return -ENOMEM;
 
-        r = manager_load_unit(u->manager, name, path, NULL, &other);
+        /* Pure ordering targets need not be loaded right-away */
+        if (!path && (d == UNIT_AFTER || d == UNIT_BEFORE))
+                r = manager_load_unit_lazy(u->manager, name, NULL, &other);
+        else
+                r = manager_load_unit(u->manager, name, path, NULL, &other);
         if (r < 0)
                 return r;
 
@@ -2445,7 +2449,11 @@ int unit_add_dependency_by_name_inverse(Unit *u, UnitDependency d, const char *n
         if (!name)
                 return -ENOMEM;
 
-        r = manager_load_unit(u->manager, name, path, NULL, &other);
+        /* Pure ordering targets need not be loaded right-away */
+        if (!path && (d == UNIT_AFTER || d == UNIT_BEFORE))
+                r = manager_load_unit_lazy(u->manager, name, NULL, &other);
+        else
+                r = manager_load_unit(u->manager, name, path, NULL, &other);
         if (r < 0)
                 return r;
 
@@ -3501,7 +3509,7 @@ int unit_remove_drop_in(Unit *u, UnitSetPropertiesMode mode, const char *name) {
         return r;
 }
 
-int unit_make_transient(Unit *u) {
+int unit_make_transient(Unit *u, UnitSetPropertiesMode mode) {
         int r;
 
         assert(u);
@@ -3513,6 +3521,12 @@ int unit_make_transient(Unit *u) {
         free(u->fragment_path);
         u->fragment_path = NULL;
 
+        /* With UNIT_MEMORY the unit only exists in memory, and the
+         * fragment path is only set so that unit_load_fragment()
+         * knows not to look for it on disk. Only scopes are created
+         * like this: across a daemon reload they keep their state and
+         * cgroup, which are serialized, but lose their settings. */
+
         if (u->manager->running_as == SYSTEMD_USER) {
                 _cleanup_free_ char *c = NULL;
 
@@ -3526,15 +3540,20 @@ int unit_make_transient(Unit *u) {
                 if (!u->fragment_path)
                         return -ENOMEM;
 
-                mkdir_p(c, 0755);
+                if (mode != UNIT_MEMORY)
+                        mkdir_p(c, 0755);
         } else {
                 u->fragment_path = strappend("/run/systemd/system/", u->id);
                 if (!u->fragment_path)
                         return -ENOMEM;
 
-                mkdir_p("/run/systemd/system", 0755);
+                if (mode != UNIT_MEMORY)
+                        mkdir_p("/run/systemd/system", 0755);
         }
 
+        if (mode == UNIT_MEMORY)
+                return 0;
+
         return write_string_file_atomic_label(u->fragment_path, "# Transient stub");
 }
 
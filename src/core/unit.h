@@ -254,6 +254,10 @@ struct Unit {
 
         bool no_gc:1;
 
+        /* Only referenced as ordering target so far, loading
+         * postponed until somebody actually needs the unit */
+        bool load_deferred:1;
+
         bool in_audit:1;
         bool on_console:1;
 
@@ -272,6 +276,7 @@ typedef enum UnitSetPropertiesMode {
         UNIT_CHECK = 0,
         UNIT_RUNTIME = 1,
         UNIT_PERSISTENT = 2,
+        UNIT_MEMORY = 3,          /* apply, but don't write anything to disk */
 } UnitSetPropertiesMode;
 
 #include "service.h"
@@ -638,7 +643,7 @@ int unit_remove_drop_in(Unit *u, UnitSetPropertiesMode mode, const char *name);
 
 int unit_kill_context(Unit *u, KillContext *c, KillOperation k, pid_t main_pid, pid_t control_pid, bool main_pid_alien);
 
-int unit_make_transient(Unit *u);
+int unit_make_transient(Unit *u, UnitSetPropertiesMode mode);
 
 int unit_require_mounts_for(Unit *u, const char *path);
 
@@ -273,18 +273,34 @@ static int retrieve(const void *data,
         return 0;
 }
 
-static void print_field(FILE* file, sd_journal *j) {
-        _cleanup_free_ char *value = NULL;
+static int retrieve_field(sd_journal *j, const char *name, char **var) {
         const void *d;
         size_t l;
+        int r;
+
+        /* Unlike enumerating all fields, this only needs to
+         * decompress the beginning of compressed fields to compare
+         * their names, so the (usually big and compressed) COREDUMP=
+         * field is skipped cheaply. */
+
+        r = sd_journal_get_data(j, name, &d, &l);
+        if (r == -ENOENT)
+                return 0;
+        if (r < 0)
+                return r;
+
+        return retrieve(d, l, name, var);
+}
+
+static void print_field(FILE* file, sd_journal *j) {
+        _cleanup_free_ char *value = NULL;
 
         assert(file);
         assert(j);
 
         assert(arg_field);
 
-        SD_JOURNAL_FOREACH_DATA(j, d, l)
-                retrieve(d, l, arg_field, &value);
+        retrieve_field(j, arg_field, &value);
 
         if (value)
                 fprintf(file, "%s\n", value);
@@ -295,8 +311,6 @@ static int print_list(FILE* file, sd_journal *j, int had_legend) {
                 *pid = NULL, *uid = NULL, *gid = NULL,
                 *sgnl = NULL, *exe = NULL, *comm = NULL, *cmdline = NULL,
                 *filename = NULL;
-        const void *d;
-        size_t l;
         usec_t t;
         char buf[FORMAT_TIMESTAMP_MAX];
         int r;
@@ -305,16 +319,14 @@ static int print_list(FILE* file, sd_journal *j, int had_legend) {
         assert(file);
         assert(j);
 
-        SD_JOURNAL_FOREACH_DATA(j, d, l) {
-                retrieve(d, l, "COREDUMP_PID", &pid);
-                retrieve(d, l, "COREDUMP_UID", &uid);
-                retrieve(d, l, "COREDUMP_GID", &gid);
-                retrieve(d, l, "COREDUMP_SIGNAL", &sgnl);
-                retrieve(d, l, "COREDUMP_EXE", &exe);
-                retrieve(d, l, "COREDUMP_COMM", &comm);
-                retrieve(d, l, "COREDUMP_CMDLINE", &cmdline);
-                retrieve(d, l, "COREDUMP_FILENAME", &filename);
-        }
+        retrieve_field(j, "COREDUMP_PID", &pid);
+        retrieve_field(j, "COREDUMP_UID", &uid);
+        retrieve_field(j, "COREDUMP_GID", &gid);
+        retrieve_field(j, "COREDUMP_SIGNAL", &sgnl);
+        retrieve_field(j, "COREDUMP_EXE", &exe);
+        retrieve_field(j, "COREDUMP_COMM", &comm);
+        retrieve_field(j, "COREDUMP_CMDLINE", &cmdline);
+        retrieve_field(j, "COREDUMP_FILENAME", &filename);
 
         if (!pid && !uid && !gid && !sgnl && !exe && !comm && !cmdline && !filename) {
                 log_warning("Empty coredump log entry");
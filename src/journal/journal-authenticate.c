@@ -27,6 +27,9 @@
 #include "journal-authenticate.h"
 #include "fsprg.h"
 
+/* Maximum number of bytes of objects we authenticate in one batch */
+#define HMAC_BATCH_MAX (64U*1024U)
+
 static uint64_t journal_file_tag_seqnum(JournalFile *f) {
         uint64_t r;
 
@@ -48,6 +51,12 @@ int journal_file_append_tag(JournalFile *f) {
         if (!f->seal)
                 return 0;
 
+        /* First, authenticate all objects appended since the last
+         * tag in one go */
+        r = journal_file_hmac_flush(f);
+        if (r < 0)
+                return r;
+
         if (!f->hmac_running)
                 return 0;
 
@@ -289,6 +298,63 @@ int journal_file_hmac_put_object(JournalFile *f, ObjectType type, Object *o, uin
         return 0;
 }
 
+int journal_file_hmac_queue_object(JournalFile *f, uint64_t p) {
+        assert(f);
+
+        if (!f->seal)
+                return 0;
+
+        /* Objects are appended and authenticated strictly in file
+         * order, hence instead of feeding each object into the HMAC
+         * while appending it, we just remember where the first
+         * unauthenticated object is, and process the whole range
+         * of objects in one go, either when the next tag is written
+         * or when the range grows large enough, so that the objects
+         * are still likely to be cache hot. */
+
+        if (f->hmac_pending_offset == 0)
+                f->hmac_pending_offset = p;
+
+        if (p - f->hmac_pending_offset >= HMAC_BATCH_MAX)
+                return journal_file_hmac_flush(f);
+
+        return 0;
+}
+
+int journal_file_hmac_flush(JournalFile *f) {
+        uint64_t p, tail;
+        int r;
+
+        assert(f);
+
+        if (!f->seal)
+                return 0;
+
+        p = f->hmac_pending_offset;
+        if (p == 0)
+                return 0;
+
+        tail = le64toh(f->header->tail_object_offset);
+
+        while (p > 0 && p <= tail) {
+                Object *o;
+
+                r = journal_file_move_to_object(f, OBJECT_UNUSED, p, &o);
+                if (r < 0)
+                        return r;
+
+                r = journal_file_hmac_put_object(f, OBJECT_UNUSED, o, p);
+                if (r < 0)
+                        return r;
+
+                p += ALIGN64(le64toh(o->object.size));
+        }
+
+        f->hmac_pending_offset = 0;
+
+        return 0;
+}
+
 int journal_file_hmac_put_header(JournalFile *f) {
         int r;
 
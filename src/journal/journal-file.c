@@ -338,13 +338,20 @@ static int journal_file_verify_header(JournalFile *f) {
 }
 
 int journal_file_fstat(JournalFile *f) {
+        bool archived;
+
         assert(f);
         assert(f->fd >= 0);
 
+        /* Check before the fstat(), so that the stat data is known
+         * to be final if the file was archived already */
+        archived = f->header && f->header->state == STATE_ARCHIVED;
+
         if (fstat(f->fd, &f->last_stat) < 0)
                 return -errno;
 
         f->last_stat_usec = now(CLOCK_MONOTONIC);
+        f->last_stat_archived = archived;
 
         /* Refuse appending to files that are already deleted */
         if (f->last_stat.st_nlink <= 0)
@@ -1023,7 +1030,7 @@ static int journal_file_append_field(
                 return r;
 
 #ifdef HAVE_GCRYPT
-        r = journal_file_hmac_put_object(f, OBJECT_FIELD, o, p);
+        r = journal_file_hmac_queue_object(f, p);
         if (r < 0)
                 return r;
 #endif
@@ -1101,7 +1108,7 @@ static int journal_file_append_data(
                 return r;
 
 #ifdef HAVE_GCRYPT
-        r = journal_file_hmac_put_object(f, OBJECT_DATA, o, p);
+        r = journal_file_hmac_queue_object(f, p);
         if (r < 0)
                 return r;
 #endif
@@ -1215,7 +1222,7 @@ static int link_entry_into_array(JournalFile *f,
                 return r;
 
 #ifdef HAVE_GCRYPT
-        r = journal_file_hmac_put_object(f, OBJECT_ENTRY_ARRAY, o, q);
+        r = journal_file_hmac_queue_object(f, q);
         if (r < 0)
                 return r;
 #endif
@@ -1363,7 +1370,7 @@ static int journal_file_append_entry_internal(
         o->entry.boot_id = f->header->boot_id;
 
 #ifdef HAVE_GCRYPT
-        r = journal_file_hmac_put_object(f, OBJECT_ENTRY, o, np);
+        r = journal_file_hmac_queue_object(f, np);
         if (r < 0)
                 return r;
 #endif
@@ -2877,7 +2884,7 @@ int journal_file_open_reliably(
                                  metrics, mmap_cache, template, ret);
 }
 
-int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint64_t p, uint64_t *seqnum, Object **ret, uint64_t *offset) {
+int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint64_t p, Hashmap *data_map, uint64_t *seqnum, Object **ret, uint64_t *offset) {
         uint64_t i, n;
         uint64_t q, xor_hash = 0;
         int r;
@@ -2892,6 +2899,13 @@ int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint6
         if (!to->writable)
                 return -EPERM;
 
+        /* If data_map is passed, it is used to remember where the
+         * data objects of "from" ended up in "to", so that data
+         * shared by many entries is only decompressed, hashed and
+         * looked up once. It is only valid as long as both files
+         * stay the same, and must be emptied by the caller
+         * otherwise. */
+
         ts.monotonic = le64toh(o->entry.monotonic);
         ts.realtime = le64toh(o->entry.realtime);
 
@@ -2909,6 +2923,19 @@ int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint6
                 q = le64toh(o->entry.items[i].object_offset);
                 le_hash = o->entry.items[i].hash;
 
+                if (data_map) {
+                        uint64_t *m;
+
+                        /* Source offset, destination offset and hash */
+                        m = hashmap_get(data_map, &q);
+                        if (m) {
+                                xor_hash ^= m[2];
+                                items[i].object_offset = htole64(m[1]);
+                                items[i].hash = htole64(m[2]);
+                                continue;
+                        }
+                }
+
                 r = journal_file_move_to_object(from, OBJECT_DATA, q, &o);
                 if (r < 0)
                         return r;
@@ -2948,6 +2975,24 @@ int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint6
                 items[i].object_offset = htole64(h);
                 items[i].hash = u->data.hash;
 
+                if (data_map) {
+                        _cleanup_free_ uint64_t *m = NULL;
+
+                        m = new(uint64_t, 3);
+                        if (!m)
+                                return -ENOMEM;
+
+                        m[0] = q;
+                        m[1] = h;
+                        m[2] = le64toh(u->data.hash);
+
+                        r = hashmap_put(data_map, m, m);
+                        if (r < 0)
+                                return r;
+
+                        m = NULL;
+                }
+
                 r = journal_file_move_to_object(from, OBJECT_ENTRY, p, &o);
                 if (r < 0)
                         return r;
@@ -76,6 +76,7 @@ typedef struct JournalFile {
         bool defrag_on_close:1;
 
         bool tail_entry_monotonic_valid:1;
+        bool last_stat_archived:1;
 
         direction_t last_direction;
         LocationType location_type;
@@ -109,6 +110,7 @@ typedef struct JournalFile {
 #ifdef HAVE_GCRYPT
         gcry_md_hd_t hmac;
         bool hmac_running;
+        uint64_t hmac_pending_offset;
 
         FSSHeader *fss_file;
         size_t fss_file_size;
@@ -220,7 +222,7 @@ int journal_file_move_to_entry_by_seqnum_for_data(JournalFile *f, uint64_t data_
 int journal_file_move_to_entry_by_realtime_for_data(JournalFile *f, uint64_t data_offset, uint64_t realtime, direction_t direction, Object **ret, uint64_t *offset);
 int journal_file_move_to_entry_by_monotonic_for_data(JournalFile *f, uint64_t data_offset, sd_id128_t boot_id, uint64_t monotonic, direction_t direction, Object **ret, uint64_t *offset);
 
-int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint64_t p, uint64_t *seqnum, Object **ret, uint64_t *offset);
+int journal_file_copy_entry(JournalFile *from, JournalFile *to, Object *o, uint64_t p, Hashmap *data_map, uint64_t *seqnum, Object **ret, uint64_t *offset);
 
 void journal_file_dump(JournalFile *f);
 void journal_file_print_header(JournalFile *f);
@@ -108,6 +108,7 @@ struct sd_journal {
         char *unique_field;
         JournalFile *unique_file;
         uint64_t unique_offset;
+        Hashmap *unique_values;
 
         int flags;
 
@@ -22,63 +22,100 @@
 #include "missing.h"
 #include "journald-audit.h"
 
-typedef struct MapField {
+typedef int (*map_field_t)(AuditParser *a, const char *field, const char **p);
+
+struct AuditFieldMap {
         const char *audit_field;
-        const char *journal_field;
-        int (*map)(const char *field, const char **p, struct iovec **iov, size_t *n_iov_allocated, unsigned *n_iov);
-} MapField;
 
-static int map_simple_field(const char *field, const char **p, struct iovec **iov, size_t *n_iov_allocated, unsigned *n_iov) {
-        _cleanup_free_ char *c = NULL;
-        size_t l = 0, allocated = 0;
-        const char *e;
+        /* Kernel fields are those occurring in the audit string
+         * before msg='. All of these fields are trusted, hence
+         * carry the "_" prefix. */
+        const char *kernel_field;
+        map_field_t kernel_map;
+
+        /* Userspace fields are those occurring in the audit string
+         * after msg='. All of these fields are untrusted, hence
+         * carry no "_" prefix. */
+        const char *userspace_field;
+        map_field_t userspace_map;
+};
 
-        assert(field);
-        assert(p);
-        assert(iov);
-        assert(n_iov);
+const struct AuditFieldMap* journald_audit_gperf_lookup(const char *key, unsigned length);
 
-        l = strlen(field);
-        allocated = l + 1;
-        c = malloc(allocated);
-        if (!c)
+static char *audit_parser_extend(AuditParser *a, size_t n) {
+        assert(a);
+
+        /* Makes room for n more bytes, returns where to write them */
+
+        if (!GREEDY_REALLOC(a->buffer, a->buffer_allocated, a->buffer_size + n))
+                return NULL;
+
+        return a->buffer + a->buffer_size;
+}
+
+static int audit_parser_commit(AuditParser *a, char *e) {
+        size_t l;
+
+        assert(a);
+        assert(e);
+
+        /* Terminates the field written since the last commit at e,
+         * and adds it to the record */
+
+        if (!GREEDY_REALLOC(a->iovec, a->n_iovec_allocated, a->n_iovec + 1))
                 return -ENOMEM;
 
-        memcpy(c, field, l);
-        for (e = *p; *e != ' ' && *e != 0; e++) {
-                if (!GREEDY_REALLOC(c, allocated, l+2))
-                        return -ENOMEM;
+        *e = 0;
+        l = e - (a->buffer + a->buffer_size);
 
-                c[l++] = *e;
-        }
+        a->iovec[a->n_iovec].iov_base = NULL;
+        a->iovec[a->n_iovec].iov_len = l;
+        a->n_iovec++;
+
+        a->buffer_size += l + 1;
+
+        return 1;
+}
+
+static int map_simple_field(AuditParser *a, const char *field, const char **p) {
+        const char *e;
+        char *c;
+        size_t l;
+        int r;
+
+        assert(a);
+        assert(field);
+        assert(p);
 
-        c[l] = 0;
+        e = *p + strcspn(*p, " ");
 
-        if (!GREEDY_REALLOC(*iov, *n_iov_allocated, *n_iov + 1))
+        l = strlen(field);
+        c = audit_parser_extend(a, l + (e - *p) + 1);
+        if (!c)
                 return -ENOMEM;
 
-        (*iov)[*n_iov].iov_base = c;
-        (*iov)[*n_iov].iov_len = l;
-        (*n_iov) ++;
+        r = audit_parser_commit(a, mempcpy(mempcpy(c, field, l), *p, e - *p));
+        if (r < 0)
+                return r;
 
         *p = e;
-        c = NULL;
-
         return 1;
 }
 
-static int map_string_field_internal(const char *field, const char **p, struct iovec **iov, size_t *n_iov_allocated, unsigned *n_iov, bool filter_printable) {
-        _cleanup_free_ char *c = NULL;
+static int map_string_field_internal(AuditParser *a, const char *field, const char **p, bool filter_printable) {
         const char *s, *e;
+        char *c, *t;
         size_t l;
+        int r;
 
+        assert(a);
         assert(field);
         assert(p);
-        assert(iov);
-        assert(n_iov);
 
         /* The kernel formats string fields in one of two formats. */
 
+        l = strlen(field);
+
         if (**p == '"') {
                 /* Normal quoted syntax */
                 s = *p + 1;
@@ -86,85 +123,70 @@ static int map_string_field_internal(const char *field, const char **p, struct i
                 if (!e)
                         return 0;
 
-                l = strlen(field) + (e - s);
-                c = malloc(l+1);
+                c = audit_parser_extend(a, l + (e - s) + 1);
                 if (!c)
                         return -ENOMEM;
 
-                *((char*) mempcpy(stpcpy(c, field), s, e - s)) = 0;
+                t = mempcpy(mempcpy(c, field, l), s, e - s);
 
                 e += 1;
 
         } else if (unhexchar(**p) >= 0) {
                 /* Hexadecimal escaping */
-                size_t allocated = 0;
+                e = *p + strcspn(*p, " ");
 
-                l = strlen(field);
-                allocated = l + 2;
-                c = malloc(allocated);
+                c = audit_parser_extend(a, l + (e - *p) / 2 + 1);
                 if (!c)
                         return -ENOMEM;
 
-                memcpy(c, field, l);
-                for (e = *p; *e != ' ' && *e != 0; e += 2) {
-                        int a, b;
-                        uint8_t x;
+                t = mempcpy(c, field, l);
+                for (s = *p; s < e; s += 2) {
+                        int x, y;
+                        uint8_t b;
 
-                        a = unhexchar(e[0]);
-                        if (a < 0)
+                        x = unhexchar(s[0]);
+                        if (x < 0)
                                 return 0;
 
-                        b = unhexchar(e[1]);
-                        if (b < 0)
+                        y = unhexchar(s[1]);
+                        if (y < 0)
                                 return 0;
 
-                        x = ((uint8_t) a << 4 | (uint8_t) b);
+                        b = ((uint8_t) x << 4 | (uint8_t) y);
 
-                        if (filter_printable && x < (uint8_t) ' ')
-                                x = (uint8_t) ' ';
+                        if (filter_printable && b < (uint8_t) ' ')
+                                b = (uint8_t) ' ';
 
-                        if (!GREEDY_REALLOC(c, allocated, l+2))
-                                return -ENOMEM;
-
-                        c[l++] = (char) x;
+                        *(t++) = (char) b;
                 }
-
-                c[l] = 0;
         } else
                 return 0;
 
-        if (!GREEDY_REALLOC(*iov, *n_iov_allocated, *n_iov + 1))
-                return -ENOMEM;
-
-        (*iov)[*n_iov].iov_base = c;
-        (*iov)[*n_iov].iov_len = l;
-        (*n_iov) ++;
+        r = audit_parser_commit(a, t);
+        if (r < 0)
+                return r;
 
         *p = e;
-        c = NULL;
-
         return 1;
 }
 
-static int map_string_field(const char *field, const char **p, struct iovec **iov, size_t *n_iov_allocated, unsigned *n_iov) {
-        return map_string_field_internal(field, p, iov, n_iov_allocated, n_iov, false);
+static int map_string_field(AuditParser *a, const char *field, const char **p) {
+        return map_string_field_internal(a, field, p, false);
 }
 
-static int map_string_field_printable(const char *field, const char **p, struct iovec **iov, size_t *n_iov_allocated, unsigned *n_iov) {
-        return map_string_field_internal(field, p, iov, n_iov_allocated, n_iov, true);
+static int map_string_field_printable(AuditParser *a, const char *field, const char **p) {
+        return map_string_field_internal(a, field, p, true);
 }
 
-static int map_generic_field(const char *prefix, const char **p, struct iovec **iov, size_t *n_iov_allocated, unsigned *n_iov) {
-        const char *e, *f;
-        char *c, *t;
-        int r;
+#include "journald-audit-gperf.h"
 
-        /* Implements fallback mappings for all fields we don't know */
+static size_t audit_field_name_length(const char *p) {
+        const char *e;
 
-        for (e = *p; e < *p + 16; e++) {
+        /* Returns the length of the field name at p, or 0 if there
+         * is no valid one followed by '=' */
 
-                if (*e == 0 || *e == ' ')
-                        return 0;
+        for (e = p; e < p + 16; e++) {
 
                 if (*e == '=')
                         break;
@@ -176,13 +198,35 @@ static int map_generic_field(const char *prefix, const char **p, struct iovec **
                         return 0;
         }
 
-        if (e <= *p || e >= *p + 16)
+        if (e >= p + 16)
                 return 0;
 
-        c = alloca(strlen(prefix) + (e - *p) + 2);
+        return e - p;
+}
+
+static int map_generic_field(AuditParser *a, const char *prefix, const char **p, size_t n) {
+        const char *e, *f;
+        char *c, *t;
+        size_t l;
+        int r;
 
-        t = stpcpy(c, prefix);
-        for (f = *p; f < e; f++) {
+        /* Implements fallback mappings for all fields we don't know */
+
+        assert(a);
+        assert(prefix);
+        assert(p);
+        assert(n > 0);
+
+        f = *p + n + 1;
+        e = f + strcspn(f, " ");
+
+        l = strlen(prefix);
+        c = audit_parser_extend(a, l + (e - *p) + 1);
+        if (!c)
+                return -ENOMEM;
+
+        t = mempcpy(c, prefix, l);
+        for (f = *p; f < *p + n; f++) {
                 char x;
 
                 if (*f >= 'a' && *f <= 'z')
@@ -194,91 +238,41 @@ static int map_generic_field(const char *prefix, const char **p, struct iovec **
 
                 *(t++) = x;
         }
-        strcpy(t, "=");
+        *(t++) = '=';
 
-        e ++;
+        f++;
+        t = mempcpy(t, f, e - f);
 
-        r = map_simple_field(c, &e, iov, n_iov_allocated, n_iov);
+        r = audit_parser_commit(a, t);
         if (r < 0)
                 return r;
 
         *p = e;
-        return r;
+        return 1;
 }
 
-/* Kernel fields are those occurring in the audit string before
- * msg='. All of these fields are trusted, hence carry the "_" prefix.
- * We try to translate the fields we know into our native names. The
- * other's are generically mapped to _AUDIT_FIELD_XYZ= */
-static const MapField map_fields_kernel[] = {
-
-        /* First, we map certain well-known audit fields into native
-         * well-known fields */
-        { "pid=",       "_PID=",                   map_simple_field },
-        { "ppid=",      "_PPID=",                  map_simple_field },
-        { "uid=",       "_UID=",                   map_simple_field },
-        { "euid=",      "_EUID=",                  map_simple_field },
-        { "fsuid=",     "_FSUID=",                 map_simple_field },
-        { "gid=",       "_GID=",                   map_simple_field },
-        { "egid=",      "_EGID=",                  map_simple_field },
-        { "fsgid=",     "_FSGID=",                 map_simple_field },
-        { "tty=",       "_TTY=",                   map_simple_field },
-        { "ses=",       "_AUDIT_SESSION=",         map_simple_field },
-        { "auid=",      "_AUDIT_LOGINUID=",        map_simple_field },
-        { "subj=",      "_SELINUX_CONTEXT=",       map_simple_field },
-        { "comm=",      "_COMM=",                  map_string_field },
-        { "exe=",       "_EXE=",                   map_string_field },
-        { "proctitle=", "_CMDLINE=",               map_string_field_printable },
-
-        /* Some fields don't map to native well-known fields. However,
-         * we know that they are string fields, hence let's undo
-         * string field escaping for them, though we stick to the
-         * generic field names. */
-        { "path=",      "_AUDIT_FIELD_PATH=",      map_string_field },
-        { "dev=",       "_AUDIT_FIELD_DEV=",       map_string_field },
-        { "name=",      "_AUDIT_FIELD_NAME=",      map_string_field },
-        {}
-};
-
-/* Userspace fields are those occurring in the audit string after
- * msg='. All of these fields are untrusted, hence carry no "_"
- * prefix. We map the fields we don't know to AUDIT_FIELD_XYZ= */
-static const MapField map_fields_userspace[] = {
-        { "cwd=",       "AUDIT_FIELD_CWD=",  map_string_field },
-        { "cmd=",       "AUDIT_FIELD_CMD=",  map_string_field },
-        { "acct=",      "AUDIT_FIELD_ACCT=", map_string_field },
-        { "exe=",       "AUDIT_FIELD_EXE=",  map_string_field },
-        { "comm=",      "AUDIT_FIELD_COMM=", map_string_field },
-        {}
-};
-
 static int map_all_fields(
+                AuditParser *a,
                 const char *p,
-                const MapField map_fields[],
-                const char *prefix,
-                bool handle_msg,
-                struct iovec **iov,
-                size_t *n_iov_allocated,
-                unsigned *n_iov) {
+                bool userspace) {
 
         int r;
 
+        assert(a);
         assert(p);
-        assert(iov);
-        assert(n_iov_allocated);
-        assert(n_iov);
 
         for (;;) {
-                bool mapped = false;
-                const MapField *m;
-                const char *v;
+                const struct AuditFieldMap *m;
+                const char *field = NULL, *v;
+                map_field_t map = NULL;
+                size_t n;
 
                 p += strspn(p, WHITESPACE);
 
                 if (*p == 0)
                         return 0;
 
-                if (handle_msg) {
+                if (!userspace) {
                         v = startswith(p, "msg='");
                         if (v) {
                                 const char *e;
@@ -297,47 +291,71 @@ static int map_all_fields(
                                         return 0; /* don't continue splitting up if the final quotation mark is missing */
 
                                 c = strndupa(v, e - v);
-                                return map_all_fields(c, map_fields_userspace, "AUDIT_FIELD_", false, iov, n_iov_allocated, n_iov);
+                                return map_all_fields(a, c, true);
                         }
                 }
 
-                /* Try to map the kernel fields to our own names */
-                for (m = map_fields; m->audit_field; m++) {
-                        v = startswith(p, m->audit_field);
-                        if (!v)
-                                continue;
+                n = audit_field_name_length(p);
+                if (n == 0) {
+                        /* Couldn't process as field, let's just skip over it */
+                        p += strcspn(p, WHITESPACE);
+                        continue;
+                }
+
+                /* Try to map the fields to our own names. The
+                 * others are generically mapped to
+                 * (_)AUDIT_FIELD_XYZ= */
+                m = journald_audit_gperf_lookup(p, n);
+                if (m) {
+                        field = userspace ? m->userspace_field : m->kernel_field;
+                        map = userspace ? m->userspace_map : m->kernel_map;
+                }
 
-                        r = m->map(m->journal_field, &v, iov, n_iov_allocated, n_iov);
+                if (map) {
+                        v = p + n + 1;
+
+                        r = map(a, field, &v);
                         if (r < 0)
                                 return log_debug_errno(r, "Failed to parse audit array: %m");
-
                         if (r > 0) {
-                                mapped = true;
                                 p = v;
-                                break;
+                                continue;
                         }
                 }
 
-                if (!mapped) {
-                        r = map_generic_field(prefix, &p, iov, n_iov_allocated, n_iov);
-                        if (r < 0)
-                                return log_debug_errno(r, "Failed to parse audit array: %m");
+                r = map_generic_field(a, userspace ? "AUDIT_FIELD_" : "_AUDIT_FIELD_", &p, n);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to parse audit array: %m");
+        }
+}
 
-                        if (r == 0) {
-                                /* Couldn't process as generic field, let's just skip over it */
-                                p += strcspn(p, WHITESPACE);
-                        }
-                }
+int audit_parser_parse(AuditParser *a, const char *p) {
+        unsigned z;
+        size_t o;
+        int r;
+
+        assert(a);
+        assert(p);
+
+        z = a->n_iovec;
+
+        r = map_all_fields(a, p, false);
+
+        /* Now that the buffer won't move anymore, point the iovecs
+         * map_all_fields() added into it. */
+        for (o = 0; z < a->n_iovec; z++) {
+                a->iovec[z].iov_base = a->buffer + o;
+                o += a->iovec[z].iov_len + 1;
         }
+
+        return r;
 }
 
 static void process_audit_string(Server *s, int type, const char *data, size_t size) {
-        _cleanup_free_ struct iovec *iov = NULL;
-        size_t n_iov_allocated = 0;
-        unsigned n_iov = 0, k;
+        AuditParser a = {};
+        unsigned k;
         uint64_t seconds, msec, id;
         const char *p;
-        unsigned z;
         char id_field[sizeof("_AUDIT_ID=") + DECIMAL_STR_MAX(uint64_t)],
              type_field[sizeof("_AUDIT_TYPE=") + DECIMAL_STR_MAX(int)],
              source_time_field[sizeof("_SOURCE_REALTIME_TIMESTAMP=") + DECIMAL_STR_MAX(usec_t)];
@@ -373,50 +391,51 @@ static void process_audit_string(Server *s, int type, const char *data, size_t s
         if (isempty(p))
                 return;
 
-        n_iov_allocated = N_IOVEC_META_FIELDS + 7;
-        iov = new(struct iovec, n_iov_allocated);
-        if (!iov) {
+        /* Borrow the buffers of the previous record */
+        a.iovec = s->audit_iovec;
+        a.n_iovec_allocated = s->audit_iovec_allocated;
+        a.buffer = s->audit_buffer;
+        a.buffer_allocated = s->audit_buffer_allocated;
+
+        if (!GREEDY_REALLOC(a.iovec, a.n_iovec_allocated, N_IOVEC_META_FIELDS + 7)) {
                 log_oom();
-                return;
+                goto finish;
         }
 
-        IOVEC_SET_STRING(iov[n_iov++], "_TRANSPORT=audit");
+        IOVEC_SET_STRING(a.iovec[a.n_iovec++], "_TRANSPORT=audit");
 
         sprintf(source_time_field, "_SOURCE_REALTIME_TIMESTAMP=%" PRIu64,
                 (usec_t) seconds * USEC_PER_SEC + (usec_t) msec * USEC_PER_MSEC);
-        IOVEC_SET_STRING(iov[n_iov++], source_time_field);
+        IOVEC_SET_STRING(a.iovec[a.n_iovec++], source_time_field);
 
         sprintf(type_field, "_AUDIT_TYPE=%i", type);
-        IOVEC_SET_STRING(iov[n_iov++], type_field);
+        IOVEC_SET_STRING(a.iovec[a.n_iovec++], type_field);
 
         sprintf(id_field, "_AUDIT_ID=%" PRIu64, id);
-        IOVEC_SET_STRING(iov[n_iov++], id_field);
+        IOVEC_SET_STRING(a.iovec[a.n_iovec++], id_field);
 
         assert_cc(32 == LOG_AUTH);
-        IOVEC_SET_STRING(iov[n_iov++], "SYSLOG_FACILITY=32");
-        IOVEC_SET_STRING(iov[n_iov++], "SYSLOG_IDENTIFIER=audit");
+        IOVEC_SET_STRING(a.iovec[a.n_iovec++], "SYSLOG_FACILITY=32");
+        IOVEC_SET_STRING(a.iovec[a.n_iovec++], "SYSLOG_IDENTIFIER=audit");
 
         m = alloca(strlen("MESSAGE=<audit-") + DECIMAL_STR_MAX(int) + strlen("> ") + strlen(p) + 1);
         sprintf(m, "MESSAGE=<audit-%i> %s", type, p);
-        IOVEC_SET_STRING(iov[n_iov++], m);
-
-        z = n_iov;
+        IOVEC_SET_STRING(a.iovec[a.n_iovec++], m);
 
-        map_all_fields(p, map_fields_kernel, "_AUDIT_FIELD_", true, &iov, &n_iov_allocated, &n_iov);
+        audit_parser_parse(&a, p);
 
-        if (!GREEDY_REALLOC(iov, n_iov_allocated, n_iov + N_IOVEC_META_FIELDS)) {
+        if (!GREEDY_REALLOC(a.iovec, a.n_iovec_allocated, a.n_iovec + N_IOVEC_META_FIELDS)) {
                 log_oom();
                 goto finish;
         }
 
-        server_dispatch_message(s, iov, n_iov, n_iov_allocated, NULL, NULL, NULL, 0, NULL, LOG_NOTICE, 0);
+        server_dispatch_message(s, a.iovec, a.n_iovec, a.n_iovec_allocated, NULL, NULL, NULL, 0, NULL, LOG_NOTICE, 0);
 
 finish:
-        /* free() all entries that map_all_fields() added. All others
-         * are allocated on the stack or are constant. */
-
-        for (; z < n_iov; z++)
-                free(iov[z].iov_base);
+        s->audit_iovec = a.iovec;
+        s->audit_iovec_allocated = a.n_iovec_allocated;
+        s->audit_buffer = a.buffer;
+        s->audit_buffer_allocated = a.buffer_allocated;
 }
 
 void server_process_audit_message(
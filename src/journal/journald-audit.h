@@ -24,6 +24,22 @@
 #include "socket-util.h"
 #include "journald-server.h"
 
+typedef struct AuditParser {
+        /* All field strings of a record are written back to back,
+         * NUL separated, into a single buffer. Since the buffer
+         * might move while it grows, the iovecs only carry the
+         * lengths until parsing is complete. */
+        struct iovec *iovec;
+        size_t n_iovec_allocated;
+        unsigned n_iovec;
+
+        char *buffer;
+        size_t buffer_allocated;
+        size_t buffer_size;
+} AuditParser;
+
 void server_process_audit_message(Server *s, const void *buffer, size_t buffer_size, const struct ucred *ucred, const union sockaddr_union *sa, socklen_t salen);
 
 int server_open_audit(Server*s);
+
+int audit_parser_parse(AuditParser *a, const char *p);
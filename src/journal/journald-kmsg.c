@@ -31,6 +31,15 @@
 #include "journald-server.h"
 #include "journald-kmsg.h"
 #include "journald-syslog.h"
+#include "udev-util.h"
+#include "strv.h"
+
+/* Maximum number of kmsg records processed per wakeup, so that a
+ * kernel log storm doesn't starve the other sources */
+#define DEV_KMSG_RECORDS_MAX 64
+
+/* Maximum number of devices whose udev fields are cached */
+#define KERNEL_DEVICES_MAX 1024
 
 void server_forward_kmsg(
         Server *s,
@@ -103,6 +112,119 @@ static bool is_us(const char *pid) {
         return t == getpid();
 }
 
+static void kernel_devices_flush(Server *s) {
+        char *id;
+
+        assert(s);
+
+        while ((id = hashmap_first_key(s->kernel_devices))) {
+                strv_free(hashmap_remove(s->kernel_devices, id));
+                free(id);
+        }
+}
+
+static int kernel_device_fields_new(Server *s, const char *kernel_device, char ***ret) {
+        _cleanup_udev_device_unref_ struct udev_device *ud = NULL;
+        _cleanup_strv_free_ char **l = NULL;
+        struct udev_list_entry *ll;
+        const char *g;
+        unsigned j = 0;
+        int r;
+
+        assert(s);
+        assert(kernel_device);
+        assert(ret);
+
+        l = new0(char*, 1);
+        if (!l)
+                return -ENOMEM;
+
+        /* Devices that don't exist end up with an empty list */
+        ud = udev_device_new_from_device_id(s->udev, kernel_device);
+        if (ud) {
+                g = udev_device_get_devnode(ud);
+                if (g) {
+                        r = strv_consume(&l, strappend("_UDEV_DEVNODE=", g));
+                        if (r < 0)
+                                return r;
+                }
+
+                g = udev_device_get_sysname(ud);
+                if (g) {
+                        r = strv_consume(&l, strappend("_UDEV_SYSNAME=", g));
+                        if (r < 0)
+                                return r;
+                }
+
+                ll = udev_device_get_devlinks_list_entry(ud);
+                udev_list_entry_foreach(ll, ll) {
+
+                        if (j > N_IOVEC_UDEV_FIELDS)
+                                break;
+
+                        g = udev_list_entry_get_name(ll);
+                        if (g) {
+                                r = strv_consume(&l, strappend("_UDEV_DEVLINK=", g));
+                                if (r < 0)
+                                        return r;
+                        }
+
+                        j++;
+                }
+        }
+
+        *ret = l;
+        l = NULL;
+
+        return 0;
+}
+
+static char **kernel_device_fields(Server *s, const char *kernel_device) {
+        _cleanup_strv_free_ char **fields = NULL;
+        _cleanup_free_ char *id = NULL;
+        char **ret;
+        int r;
+
+        assert(s);
+        assert(kernel_device);
+
+        /* Looking up a device in udev means reading a bunch of
+         * files from sysfs and the udev database, and kernel devices
+         * tend to log repeatedly. Hence remember the result until a
+         * uevent tells us that something changed. If we can't watch
+         * for uevents the cache is flushed after each batch of
+         * records instead. */
+
+        ret = hashmap_get(s->kernel_devices, kernel_device);
+        if (ret)
+                return ret;
+
+        if (hashmap_size(s->kernel_devices) >= KERNEL_DEVICES_MAX)
+                kernel_devices_flush(s);
+
+        r = hashmap_ensure_allocated(&s->kernel_devices, &string_hash_ops);
+        if (r < 0)
+                return NULL;
+
+        r = kernel_device_fields_new(s, kernel_device, &fields);
+        if (r < 0)
+                return NULL;
+
+        id = strdup(kernel_device);
+        if (!id)
+                return NULL;
+
+        r = hashmap_put(s->kernel_devices, id, fields);
+        if (r < 0)
+                return NULL;
+
+        id = NULL;
+        ret = fields;
+        fields = NULL;
+
+        return ret;
+}
+
 static void dev_kmsg_record(Server *s, const char *p, size_t l) {
         struct iovec iovec[N_IOVEC_META_FIELDS + 7 + N_IOVEC_KERNEL_FIELDS + 2 + N_IOVEC_UDEV_FIELDS];
         char *message = NULL, *syslog_priority = NULL, *syslog_pid = NULL, *syslog_facility = NULL, *syslog_identifier = NULL, *source_time = NULL;
@@ -216,53 +338,12 @@ static void dev_kmsg_record(Server *s, const char *p, size_t l) {
         }
 
         if (kernel_device) {
-                struct udev_device *ud;
-
-                ud = udev_device_new_from_device_id(s->udev, kernel_device);
-                if (ud) {
-                        const char *g;
-                        struct udev_list_entry *ll;
-                        char *b;
-
-                        g = udev_device_get_devnode(ud);
-                        if (g) {
-                                b = strappend("_UDEV_DEVNODE=", g);
-                                if (b) {
-                                        IOVEC_SET_STRING(iovec[n++], b);
-                                        z++;
-                                }
-                        }
-
-                        g = udev_device_get_sysname(ud);
-                        if (g) {
-                                b = strappend("_UDEV_SYSNAME=", g);
-                                if (b) {
-                                        IOVEC_SET_STRING(iovec[n++], b);
-                                        z++;
-                                }
-                        }
-
-                        j = 0;
-                        ll = udev_device_get_devlinks_list_entry(ud);
-                        udev_list_entry_foreach(ll, ll) {
-
-                                if (j > N_IOVEC_UDEV_FIELDS)
-                                        break;
-
-                                g = udev_list_entry_get_name(ll);
-                                if (g) {
-                                        b = strappend("_UDEV_DEVLINK=", g);
-                                        if (b) {
-                                                IOVEC_SET_STRING(iovec[n++], b);
-                                                z++;
-                                        }
-                                }
+                char **g;
 
-                                j++;
-                        }
-
-                        udev_device_unref(ud);
-                }
+                /* These are owned by the cache, hence not counted
+                 * in z */
+                STRV_FOREACH(g, kernel_device_fields(s, kernel_device))
+                        IOVEC_SET_STRING(iovec[n++], *g);
         }
 
         if (asprintf(&source_time, "_SOURCE_MONOTONIC_TIMESTAMP=%llu", usec) >= 0)
@@ -376,6 +457,8 @@ int server_flush_dev_kmsg(Server *s) {
 
 static int dispatch_dev_kmsg(sd_event_source *es, int fd, uint32_t revents, void *userdata) {
         Server *s = userdata;
+        unsigned i;
+        int r = 0;
 
         assert(es);
         assert(fd == s->dev_kmsg_fd);
@@ -387,7 +470,97 @@ static int dispatch_dev_kmsg(sd_event_source *es, int fd, uint32_t revents, void
         if (!(revents & EPOLLIN))
                 log_error("Got invalid event from epoll for /dev/kmsg: %"PRIx32, revents);
 
-        return server_read_dev_kmsg(s);
+        /* Each read() returns exactly one record, but there's no
+         * need to go back to the event loop for each of them */
+        for (i = 0; i < DEV_KMSG_RECORDS_MAX; i++) {
+                r = server_read_dev_kmsg(s);
+                if (r <= 0)
+                        break;
+        }
+
+        if (!s->kernel_device_monitor)
+                kernel_devices_flush(s);
+
+        return r;
+}
+
+static int dispatch_kernel_device_monitor(sd_event_source *es, int fd, uint32_t revents, void *userdata) {
+        _cleanup_udev_device_unref_ struct udev_device *d = NULL;
+        Server *s = userdata;
+
+        assert(s);
+
+        /* Something was added, removed, renamed or otherwise
+         * changed, don't bother finding out which cached device
+         * this affects. If no device could be received, uevents
+         * might have been lost because the socket overflowed, hence
+         * flush the cache in that case too. */
+        d = udev_monitor_receive_device(s->kernel_device_monitor);
+        kernel_devices_flush(s);
+
+        return 0;
+}
+
+int server_open_kernel_device_monitor(Server *s) {
+        int r;
+
+        assert(s);
+        assert(s->udev);
+
+        /* Without the monitor the udev field cache is short-lived,
+         * but that's no reason to fail */
+
+        if (s->dev_kmsg_fd < 0)
+                return 0;
+
+        s->kernel_device_monitor = udev_monitor_new_from_netlink(s->udev, "udev");
+        if (!s->kernel_device_monitor) {
+                log_debug("Failed to allocate udev monitor, not caching kernel device data.");
+                return 0;
+        }
+
+        /* Uevent storms during coldplug are common, make overflows
+         * rare. This will fail if we are unprivileged, but that
+         * doesn't matter much. */
+        udev_monitor_set_receive_buffer_size(s->kernel_device_monitor, 128*1024*1024);
+
+        r = udev_monitor_enable_receiving(s->kernel_device_monitor);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to enable udev monitor, not caching kernel device data: %m");
+                goto fail;
+        }
+
+        r = sd_event_add_io(s->event, &s->kernel_device_event_source, udev_monitor_get_fd(s->kernel_device_monitor), EPOLLIN, dispatch_kernel_device_monitor, s);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to watch udev monitor, not caching kernel device data: %m");
+                goto fail;
+        }
+
+        /* Process uevents before kmsg records, so that we never
+         * use data that is already known to be stale */
+        r = sd_event_source_set_priority(s->kernel_device_event_source, SD_EVENT_PRIORITY_IMPORTANT+5);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to adjust priority of udev monitor event source: %m");
+                goto fail;
+        }
+
+        return 0;
+
+fail:
+        s->kernel_device_event_source = sd_event_source_unref(s->kernel_device_event_source);
+        s->kernel_device_monitor = udev_monitor_unref(s->kernel_device_monitor);
+
+        return 0;
+}
+
+void server_done_kernel_devices(Server *s) {
+        assert(s);
+
+        kernel_devices_flush(s);
+        hashmap_free(s->kernel_devices);
+
+        sd_event_source_unref(s->kernel_device_event_source);
+        udev_monitor_unref(s->kernel_device_monitor);
 }
 
 int server_open_dev_kmsg(Server *s) {
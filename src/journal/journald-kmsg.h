@@ -26,6 +26,9 @@
 int server_open_dev_kmsg(Server *s);
 int server_flush_dev_kmsg(Server *s);
 
+int server_open_kernel_device_monitor(Server *s);
+void server_done_kernel_devices(Server *s);
+
 void server_forward_kmsg(Server *s, int priority, const char *identifier, const char *message, const struct ucred *ucred);
 
 int server_open_kernel_seqnum(Server *s);
@@ -34,6 +34,7 @@
 #include "fileio.h"
 #include "mkdir.h"
 #include "hashmap.h"
+#include "strv.h"
 #include "journal-file.h"
 #include "socket-util.h"
 #include "cgroup-util.h"
@@ -154,6 +155,126 @@ int config_parse_line_max(
         return 0;
 }
 
+static int scan_usage(Server *s, const char *path, const struct stat *st) {
+        _cleanup_closedir_ DIR *d = NULL;
+        _cleanup_strv_free_ char **active = NULL;
+        _cleanup_free_ char *copy = NULL;
+        uint64_t archived = 0;
+        int r;
+
+        assert(s);
+        assert(path);
+        assert(st);
+
+        d = opendir(path);
+        if (!d)
+                return -errno;
+
+        copy = strdup(path);
+        if (!copy)
+                return -ENOMEM;
+
+        for (;;) {
+                struct stat fst;
+                struct dirent *de;
+
+                errno = 0;
+                de = readdir(d);
+                if (!de && errno != 0)
+                        return -errno;
+
+                if (!de)
+                        break;
+
+                if (!endswith(de->d_name, ".journal") &&
+                    !endswith(de->d_name, ".journal~"))
+                        continue;
+
+                /* Files that are still written to are looked at
+                 * every time, see current_usage() */
+                if (!strchr(de->d_name, '@') && !endswith(de->d_name, "~")) {
+                        r = strv_extend(&active, de->d_name);
+                        if (r < 0)
+                                return r;
+
+                        continue;
+                }
+
+                if (fstatat(dirfd(d), de->d_name, &fst, AT_SYMLINK_NOFOLLOW) < 0)
+                        continue;
+
+                if (!S_ISREG(fst.st_mode))
+                        continue;
+
+                archived += (uint64_t) fst.st_blocks * 512UL;
+        }
+
+        free(s->usage_path);
+        s->usage_path = copy;
+        copy = NULL;
+
+        strv_free(s->usage_active);
+        s->usage_active = active;
+        active = NULL;
+
+        s->usage_archived = archived;
+        s->usage_mtime = timespec_load(&st->st_mtim);
+
+        return 0;
+}
+
+static void invalidate_usage(Server *s) {
+        assert(s);
+
+        s->usage_mtime = 0;
+        s->cached_available_space_timestamp = 0;
+}
+
+static int current_usage(Server *s, const char *path, uint64_t *ret) {
+        struct stat st;
+        uint64_t sum;
+        char **fn;
+        int r;
+
+        assert(s);
+        assert(path);
+        assert(ret);
+
+        /* Any file being created, renamed or removed in the
+         * directory bumps its mtime, and so does rotating and
+         * vacuuming. Only then do we need to scan it again. */
+        if (stat(path, &st) < 0)
+                return -errno;
+
+        if (s->usage_mtime == 0 ||
+            s->usage_mtime != timespec_load(&st.st_mtim) ||
+            !streq_ptr(s->usage_path, path)) {
+                r = scan_usage(s, path, &st);
+                if (r < 0)
+                        return r;
+        }
+
+        sum = s->usage_archived;
+
+        STRV_FOREACH(fn, s->usage_active) {
+                struct stat fst;
+                const char *q;
+
+                q = strjoina(path, "/", *fn);
+
+                if (lstat(q, &fst) < 0)
+                        continue;
+
+                if (!S_ISREG(fst.st_mode))
+                        continue;
+
+                sum += (uint64_t) fst.st_blocks * 512UL;
+        }
+
+        *ret = sum;
+        return 0;
+}
+
 static uint64_t available_space(Server *s, bool verbose) {
         char ids[33];
         _cleanup_free_ char *p = NULL;
@@ -161,7 +282,6 @@ static uint64_t available_space(Server *s, bool verbose) {
         struct statvfs ss;
         uint64_t sum = 0, ss_avail = 0, avail = 0;
         int r;
-        _cleanup_closedir_ DIR *d = NULL;
         usec_t ts;
         const char *f;
         JournalMetrics *m;
@@ -190,38 +310,13 @@ static uint64_t available_space(Server *s, bool verbose) {
         if (!p)
                 return 0;
 
-        d = opendir(p);
-        if (!d)
+        if (statvfs(p, &ss) < 0)
                 return 0;
 
-        if (fstatvfs(dirfd(d), &ss) < 0)
+        r = current_usage(s, p, &sum);
+        if (r < 0)
                 return 0;
 
-        for (;;) {
-                struct stat st;
-                struct dirent *de;
-
-                errno = 0;
-                de = readdir(d);
-                if (!de && errno != 0)
-                        return 0;
-
-                if (!de)
-                        break;
-
-                if (!endswith(de->d_name, ".journal") &&
-                    !endswith(de->d_name, ".journal~"))
-                        continue;
-
-                if (fstatat(dirfd(d), de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0)
-                        continue;
-
-                if (!S_ISREG(st.st_mode))
-                        continue;
-
-                sum += (uint64_t) st.st_blocks * 512UL;
-        }
-
         ss_avail = ss.f_bsize * ss.f_bavail;
 
         /* If we reached a high mark, we will always allow this much
@@ -510,6 +605,8 @@ void server_rotate(Server *s) {
 
         log_debug("Rotating...");
 
+        invalidate_usage(s);
+
         do_rotate(s, &s->runtime_journal, "runtime", false, 0);
         do_rotate(s, &s->system_journal, "system", s->seal, 0);
 
@@ -601,7 +698,7 @@ void server_vacuum(Server *s) {
         do_vacuum(s, ids, s->system_journal, "/var/log/journal/", &s->system_metrics);
         do_vacuum(s, ids, s->runtime_journal, "/run/log/journal/", &s->runtime_metrics);
 
-        s->cached_available_space_timestamp = 0;
+        invalidate_usage(s);
 }
 
 static void server_cache_machine_id(Server *s) {
@@ -1113,7 +1210,25 @@ finish:
         dispatch_message_real(s, iovec, n, m, ucred, tv, label, label_len, unit_id, priority, object_pid);
 }
 
+static void data_maps_clear(Hashmap *data_maps) {
+        Hashmap *data_map;
+        Iterator i;
+
+        HASHMAP_FOREACH(data_map, data_maps, i)
+                hashmap_clear_free(data_map);
+}
+
+static void data_maps_free(Hashmap *data_maps) {
+        Hashmap *data_map;
+
+        while ((data_map = hashmap_steal_first(data_maps)))
+                hashmap_free_free(data_map);
+
+        hashmap_free(data_maps);
+}
+
 int server_flush_to_var(Server *s, bool require_flag_file) {
+        Hashmap *data_maps = NULL;
         sd_id128_t machine;
         sd_journal *j = NULL;
         char ts[FORMAT_TIMESPAN_MAX];
@@ -1151,13 +1266,41 @@ int server_flush_to_var(Server *s, bool require_flag_file) {
 
         sd_journal_set_data_threshold(j, 0);
 
+        /* Most entries share the bulk of their data objects with
+         * earlier ones, remember where they ended up in the system
+         * journal, so that they are copied only once. Entries of
+         * the runtime files are interleaved, hence keep one map per
+         * source file. */
+        data_maps = hashmap_new(NULL);
+        if (!data_maps) {
+                r = log_oom();
+                goto finish;
+        }
+
         SD_JOURNAL_FOREACH(j) {
+                Hashmap *data_map;
                 Object *o = NULL;
                 JournalFile *f;
 
                 f = j->current_file;
                 assert(f && f->current_offset > 0);
 
+                data_map = hashmap_get(data_maps, f);
+                if (!data_map) {
+                        data_map = hashmap_new(&uint64_hash_ops);
+                        if (!data_map) {
+                                r = log_oom();
+                                goto finish;
+                        }
+
+                        r = hashmap_put(data_maps, f, data_map);
+                        if (r < 0) {
+                                hashmap_free(data_map);
+                                r = log_oom();
+                                goto finish;
+                        }
+                }
+
                 n++;
 
                 r = journal_file_move_to_object(f, OBJECT_ENTRY, f->current_offset, &o);
@@ -1166,7 +1309,7 @@ int server_flush_to_var(Server *s, bool require_flag_file) {
                         goto finish;
                 }
 
-                r = journal_file_copy_entry(f, s->system_journal, o, f->current_offset, NULL, NULL, NULL);
+                r = journal_file_copy_entry(f, s->system_journal, o, f->current_offset, data_map, NULL, NULL, NULL);
                 if (r >= 0)
                         continue;
 
@@ -1184,8 +1327,11 @@ int server_flush_to_var(Server *s, bool require_flag_file) {
                         goto finish;
                 }
 
+                /* Offsets into the old system journal are useless now */
+                data_maps_clear(data_maps);
+
                 log_debug("Retrying write.");
-                r = journal_file_copy_entry(f, s->system_journal, o, f->current_offset, NULL, NULL, NULL);
+                r = journal_file_copy_entry(f, s->system_journal, o, f->current_offset, data_map, NULL, NULL, NULL);
                 if (r < 0) {
                         log_error_errno(r, "Can't write entry: %m");
                         goto finish;
@@ -1193,6 +1339,8 @@ int server_flush_to_var(Server *s, bool require_flag_file) {
         }
 
 finish:
+        data_maps_free(data_maps);
+
         if (s->system_journal)
                 journal_file_post_change(s->system_journal);
 
@@ -1889,6 +2037,10 @@ int server_init(Server *s) {
         if (!s->udev)
                 return -ENOMEM;
 
+        r = server_open_kernel_device_monitor(s);
+        if (r < 0)
+                return r;
+
         s->rate_limit = journal_rate_limit_new(s->rate_limit_interval, s->rate_limit_burst);
         if (!s->rate_limit)
                 return -ENOMEM;
@@ -1939,6 +2091,9 @@ void server_done(Server *s) {
         while ((f = ordered_hashmap_steal_first(s->user_journals)))
                 journal_file_close(f);
 
+        free(s->usage_path);
+        strv_free(s->usage_active);
+
         ordered_hashmap_free(s->user_journals);
 
         sd_event_source_unref(s->syslog_event_source);
@@ -1971,6 +2126,8 @@ void server_done(Server *s) {
                 munmap(s->kernel_seqnum, sizeof(uint64_t));
 
         free(s->buffer);
+        free(s->audit_iovec);
+        free(s->audit_buffer);
         free(s->tty_path);
         free(s->cgroup_root);
         free(s->hostname_field);
@@ -1978,6 +2135,8 @@ void server_done(Server *s) {
         if (s->mmap)
                 mmap_cache_unref(s->mmap);
 
+        server_done_kernel_devices(s);
+
         if (s->udev)
                 udev_unref(s->udev);
 }
@@ -89,6 +89,13 @@ struct Server {
         char *buffer;
         size_t buffer_size;
 
+        /* Reused for every audit record, so that decoding one
+         * doesn't need to allocate anything in the common case */
+        struct iovec *audit_iovec;
+        size_t audit_iovec_allocated;
+        char *audit_buffer;
+        size_t audit_buffer_allocated;
+
         JournalRateLimit *rate_limit;
         usec_t sync_interval_usec;
         usec_t rate_limit_interval;
@@ -111,6 +118,14 @@ struct Server {
         uint64_t cached_available_space;
         usec_t cached_available_space_timestamp;
 
+        /* Journal directory usage as of the last scan. Archived
+         * files never change, so only the active ones need to be
+         * looked at again, as long as the directory stays the same. */
+        char *usage_path;
+        usec_t usage_mtime;
+        uint64_t usage_archived;
+        char **usage_active;
+
         uint64_t var_available_timestamp;
 
         usec_t max_retention_usec;
@@ -135,6 +150,9 @@ struct Server {
         MMapCache *mmap;
 
         struct udev *udev;
+        struct udev_monitor *kernel_device_monitor;
+        sd_event_source *kernel_device_event_source;
+        Hashmap *kernel_devices;
 
         uint64_t *kernel_seqnum;
         bool dev_kmsg_readable:1;
@@ -1338,6 +1338,29 @@ static void remove_file(sd_journal *j, const char *prefix, const char *filename)
         remove_file_real(j, f);
 }
 
+typedef struct UniqueValue {
+        uint64_t hash;
+
+        /* The file the value was seen in first. Only that is
+         * remembered, not the payload, so that enumerating a field
+         * with lots of different values doesn't need lots of
+         * memory. The value is looked up there by its hash again
+         * when needed. */
+        JournalFile *file;
+} UniqueValue;
+
+static void unique_values_forget_file(sd_journal *j, JournalFile *f) {
+        UniqueValue *v;
+        Iterator i;
+
+        assert(j);
+        assert(f);
+
+        HASHMAP_FOREACH(v, j->unique_values, i)
+                if (v->file == f)
+                        v->file = NULL;
+}
+
 static void remove_file_real(sd_journal *j, JournalFile *f) {
         assert(j);
         assert(f);
@@ -1351,6 +1374,8 @@ static void remove_file_real(sd_journal *j, JournalFile *f) {
                 j->current_field = 0;
         }
 
+        unique_values_forget_file(j, f);
+
         if (j->unique_file == f) {
                 /* Jump to the next unique_file or NULL if that one was last */
                 j->unique_file = ordered_hashmap_next(j->files, j->unique_file->path);
@@ -1897,6 +1922,7 @@ _public_ void sd_journal_close(sd_journal *j) {
 
         free(j->path);
         free(j->prefix);
+        hashmap_free_free(j->unique_values);
         free(j->unique_field);
         free(j);
 }
@@ -2547,6 +2573,23 @@ _public_ int sd_journal_get_usage(sd_journal *j, uint64_t *bytes) {
         ORDERED_HASHMAP_FOREACH(f, j->files, i) {
                 struct stat st;
 
+                /* Archived files do not change anymore, hence the
+                 * stat data from after they were archived is still
+                 * accurate. Files that were archived only after we
+                 * opened them need to be looked at once more. */
+                if (f->header->state == STATE_ARCHIVED) {
+                        if (!f->last_stat_archived) {
+                                int r;
+
+                                r = journal_file_fstat(f);
+                                if (r < 0 && r != -EIDRM)
+                                        return r;
+                        }
+
+                        sum += (uint64_t) f->last_stat.st_blocks * 512ULL;
+                        continue;
+                }
+
                 if (fstat(f->fd, &st) < 0)
                         return -errno;
 
@@ -2557,6 +2600,71 @@ _public_ int sd_journal_get_usage(sd_journal *j, uint64_t *bytes) {
         return 0;
 }
 
+static int unique_value_remember(sd_journal *j, JournalFile *f, uint64_t hash) {
+        UniqueValue *v;
+        int r;
+
+        assert(j);
+        assert(f);
+
+        r = hashmap_ensure_allocated(&j->unique_values, &uint64_hash_ops);
+        if (r < 0)
+                return r;
+
+        v = new(UniqueValue, 1);
+        if (!v)
+                return -ENOMEM;
+
+        v->hash = hash;
+        v->file = f;
+
+        r = hashmap_put(j->unique_values, &v->hash, v);
+        if (r < 0) {
+                free(v);
+                return r;
+        }
+
+        return 0;
+}
+
+static int unique_value_in_earlier_files(sd_journal *j, const void *data, size_t size, uint64_t hash) {
+        JournalFile *of;
+        Iterator i;
+        int r;
+
+        assert(j);
+        assert(data);
+
+        ORDERED_HASHMAP_FOREACH(of, j->files, i) {
+                Object *oo;
+                uint64_t op;
+
+                if (of == j->unique_file)
+                        break;
+
+                /* Skip this file it didn't have any fields
+                 * indexed */
+                if (JOURNAL_HEADER_CONTAINS(of->header, n_fields) &&
+                    le64toh(of->header->n_fields) <= 0)
+                        continue;
+
+                r = journal_file_find_data_object_with_hash(of, data, size, hash, &oo, &op);
+                if (r != 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+static void unique_values_flush(sd_journal *j) {
+        UniqueValue *v;
+
+        assert(j);
+
+        while ((v = hashmap_steal_first(j->unique_values)))
+                free(v);
+}
+
 _public_ int sd_journal_query_unique(sd_journal *j, const char *field) {
         char *f;
 
@@ -2574,6 +2682,7 @@ _public_ int sd_journal_query_unique(sd_journal *j, const char *field) {
         j->unique_file = NULL;
         j->unique_offset = 0;
         j->unique_file_lost = false;
+        unique_values_flush(j);
 
         return 0;
 }
@@ -2601,12 +2710,11 @@ _public_ int sd_journal_enumerate_unique(sd_journal *j, const void **data, size_
         }
 
         for (;;) {
-                JournalFile *of;
-                Iterator i;
+                UniqueValue *v;
                 Object *o;
                 const void *odata;
                 size_t ol;
-                bool found;
+                uint64_t h;
                 int r;
 
                 /* Proceed to next data object in the field's linked list */
@@ -2668,33 +2776,42 @@ _public_ int sd_journal_enumerate_unique(sd_journal *j, const void **data, size_
                 }
 
                 /* OK, now let's see if we already returned this data
-                 * object by checking if it exists in the earlier
-                 * traversed files. */
-                found = false;
-                ORDERED_HASHMAP_FOREACH(of, j->files, i) {
-                        Object *oo;
-                        uint64_t op;
-
-                        if (of == j->unique_file)
-                                break;
-
-                        /* Skip this file it didn't have any fields
-                         * indexed */
-                        if (JOURNAL_HEADER_CONTAINS(of->header, n_fields) &&
-                            le64toh(of->header->n_fields) <= 0)
-                                continue;
-
-                        r = journal_file_find_data_object_with_hash(of, odata, ol, le64toh(o->data.hash), &oo, &op);
+                 * object. Everything returned so far is remembered
+                 * by its hash, so that in the common case neither
+                 * duplicates nor new values require looking into
+                 * all the earlier traversed files. */
+                h = le64toh(o->data.hash);
+
+                v = hashmap_get(j->unique_values, &h);
+                if (!v) {
+                        r = unique_value_remember(j, j->unique_file, h);
                         if (r < 0)
                                 return r;
+                } else {
+                        /* A file never contains the same data
+                         * twice, hence if the value with this hash
+                         * was first seen in the current file, this
+                         * is a collision. Otherwise look up the value
+                         * in the file it was first seen in. */
+                        if (v->file && v->file != j->unique_file) {
+                                Object *oo;
+                                uint64_t op;
+
+                                r = journal_file_find_data_object_with_hash(v->file, odata, ol, h, &oo, &op);
+                                if (r < 0)
+                                        return r;
+                                if (r > 0)
+                                        continue;
+                        }
 
+                        /* Hash collision, check the hard way */
+                        r = unique_value_in_earlier_files(j, odata, ol, h);
+                        if (r < 0)
+                                return r;
                         if (r > 0)
-                                found = true;
+                                continue;
                 }
 
-                if (found)
-                        continue;
-
                 r = return_data(j, j->unique_file, o, data, l);
                 if (r < 0)
                         return r;
@@ -2710,6 +2827,7 @@ _public_ void sd_journal_restart_unique(sd_journal *j) {
         j->unique_file = NULL;
         j->unique_offset = 0;
         j->unique_file_lost = false;
+        unique_values_flush(j);
 }
 
 _public_ int sd_journal_reliable_fd(sd_journal *j) {
@@ -0,0 +1,95 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  Copyright 2015 Lennart Poettering
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include "journald-audit.h"
+#include "strv.h"
+#include "macro.h"
+
+static void test_audit_parser_parse(const char *str, char **fields) {
+        AuditParser a = {};
+        unsigned i;
+
+        assert_se(audit_parser_parse(&a, str) >= 0);
+
+        for (i = 0; i < a.n_iovec; i++)
+                log_info("%.*s", (int) a.iovec[i].iov_len, (const char*) a.iovec[i].iov_base);
+
+        assert_se(a.n_iovec == strv_length(fields));
+
+        for (i = 0; i < a.n_iovec; i++) {
+                assert_se(a.iovec[i].iov_len == strlen(fields[i]));
+                assert_se(memcmp(a.iovec[i].iov_base, fields[i], a.iovec[i].iov_len) == 0);
+        }
+
+        free(a.iovec);
+        free(a.buffer);
+}
+
+int main(int argc, char *argv[]) {
+        log_parse_environment();
+        log_open();
+
+        /* Kernel record, fields get the trusted names */
+        test_audit_parser_parse(
+                        "arch=c000003e syscall=59 ppid=1 pid=2345 auid=4294967295 uid=0 "
+                        "tty=(none) ses=4294967295 comm=\"systemd-journal\" "
+                        "exe=\"/usr/lib/systemd/systemd-journald\" "
+                        "subj=system_u:system_r:syslogd_t:s0 key=(null)",
+                        STRV_MAKE("_AUDIT_FIELD_ARCH=c000003e",
+                                  "_AUDIT_FIELD_SYSCALL=59",
+                                  "_PPID=1",
+                                  "_PID=2345",
+                                  "_AUDIT_LOGINUID=4294967295",
+                                  "_UID=0",
+                                  "_TTY=(none)",
+                                  "_AUDIT_SESSION=4294967295",
+                                  "_COMM=systemd-journal",
+                                  "_EXE=/usr/lib/systemd/systemd-journald",
+                                  "_SELINUX_CONTEXT=system_u:system_r:syslogd_t:s0",
+                                  "_AUDIT_FIELD_KEY=(null)"));
+
+        /* Hex encoded kernel fields */
+        test_audit_parser_parse(
+                        "proctitle=2F7573722F6C69622F73797374656D642F0073797374656D642D6A6F75726E616C64 "
+                        "path=2F746D702F612062 name=(null)",
+                        STRV_MAKE("_CMDLINE=/usr/lib/systemd/ systemd-journald",
+                                  "_AUDIT_FIELD_PATH=/tmp/a b",
+                                  "_AUDIT_FIELD_NAME=(null)"));
+
+        /* Userspace record, fields after msg=' are untrusted */
+        test_audit_parser_parse(
+                        "pid=1 uid=0 auid=4294967295 ses=4294967295 "
+                        "msg='unit=systemd-journald comm=\"systemd\" exe=\"/usr/lib/systemd/systemd\" "
+                        "res=success cwd=\"/\" acct=726F6F74 cmd=6C73'",
+                        STRV_MAKE("_PID=1",
+                                  "_UID=0",
+                                  "_AUDIT_LOGINUID=4294967295",
+                                  "_AUDIT_SESSION=4294967295",
+                                  "AUDIT_FIELD_UNIT=systemd-journald",
+                                  "AUDIT_FIELD_COMM=systemd",
+                                  "AUDIT_FIELD_EXE=/usr/lib/systemd/systemd",
+                                  "AUDIT_FIELD_RES=success",
+                                  "AUDIT_FIELD_CWD=/",
+                                  "AUDIT_FIELD_ACCT=root",
+                                  "AUDIT_FIELD_CMD=ls"));
+
+        return 0;
+}
@@ -29,7 +29,8 @@
 int main(int argc, char *argv[]) {
 
         char dn[] = "/var/tmp/test-journal-flush.XXXXXX", *fn;
-        JournalFile *new_journal = NULL;
+        _cleanup_hashmap_free_free_ Hashmap *data_map = NULL;
+        JournalFile *new_journal = NULL, *last = NULL;
         sd_journal *j = NULL;
         unsigned n = 0;
         int r;
@@ -45,6 +46,9 @@ int main(int argc, char *argv[]) {
 
         sd_journal_set_data_threshold(j, 0);
 
+        data_map = hashmap_new(&uint64_hash_ops);
+        assert_se(data_map);
+
         SD_JOURNAL_FOREACH(j) {
                 Object *o;
                 JournalFile *f;
@@ -52,10 +56,15 @@ int main(int argc, char *argv[]) {
                 f = j->current_file;
                 assert_se(f && f->current_offset > 0);
 
+                if (f != last) {
+                        hashmap_clear_free(data_map);
+                        last = f;
+                }
+
                 r = journal_file_move_to_object(f, OBJECT_ENTRY, f->current_offset, &o);
                 assert_se(r >= 0);
 
-                r = journal_file_copy_entry(f, new_journal, o, f->current_offset, NULL, NULL, NULL);
+                r = journal_file_copy_entry(f, new_journal, o, f->current_offset, data_map, NULL, NULL, NULL);
                 assert_se(r >= 0);
 
                 n++;
@@ -65,6 +74,8 @@ int main(int argc, char *argv[]) {
 
         sd_journal_close(j);
 
+        assert_se(le64toh(new_journal->header->n_entries) == n);
+
         journal_file_close(new_journal);
 
         unlink(fn);
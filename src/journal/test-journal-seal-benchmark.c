@@ -0,0 +1,155 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "util.h"
+#include "log.h"
+#include "journal-file.h"
+#include "journal-verify.h"
+#include "journal-authenticate.h"
+#include "fsprg.h"
+
+#define N_ENTRIES 20000
+#define RANDOM_RANGE 1000
+#define INTERVAL_USEC (15 * USEC_PER_MINUTE)
+
+static char *setup_seal(JournalFile *f) {
+        size_t mpk_size, seed_size, state_size, i;
+        uint8_t *mpk, *seed;
+        uint64_t start;
+        char *key, *k;
+
+        /* Generates a fresh sealing key in memory, the same way
+         * "journalctl --setup-keys" does, and turns on sealing for
+         * the freshly created file. Returns the verification key. */
+
+        mpk_size = FSPRG_mpkinbytes(FSPRG_RECOMMENDED_SECPAR);
+        seed_size = FSPRG_RECOMMENDED_SEEDLEN;
+        state_size = FSPRG_stateinbytes(FSPRG_RECOMMENDED_SECPAR);
+
+        mpk = alloca(mpk_size);
+        seed = alloca(seed_size);
+
+        assert_se(dev_urandom(seed, seed_size) >= 0);
+
+        FSPRG_GenMK(NULL, mpk, seed, seed_size, FSPRG_RECOMMENDED_SECPAR);
+
+        f->fsprg_state = malloc(state_size);
+        assert_se(f->fsprg_state);
+        f->fsprg_state_size = state_size;
+        FSPRG_GenState0(f->fsprg_state, mpk, seed, seed_size);
+
+        start = now(CLOCK_REALTIME) / INTERVAL_USEC;
+        f->fss_start_usec = start * INTERVAL_USEC;
+        f->fss_interval_usec = INTERVAL_USEC;
+
+        f->seal = true;
+        f->header->compatible_flags |= htole32(HEADER_COMPATIBLE_SEALED);
+
+        assert_se(journal_file_hmac_setup(f) >= 0);
+        assert_se(journal_file_append_first_tag(f) >= 0);
+
+        key = k = malloc(seed_size * 3 + 2 + 2 * DECIMAL_STR_MAX(uint64_t));
+        assert_se(key);
+
+        for (i = 0; i < seed_size; i++) {
+                if (i > 0 && i % 3 == 0)
+                        *(k++) = '-';
+
+                k += sprintf(k, "%02x", seed[i]);
+        }
+
+        sprintf(k, "/%llx-%llx", (unsigned long long) start, (unsigned long long) INTERVAL_USEC);
+
+        return key;
+}
+
+static usec_t append_entries(const char *fn, bool seal, char **key) {
+        JournalFile *f;
+        usec_t n;
+        unsigned i;
+
+        assert_se(journal_file_open(fn, O_RDWR|O_CREAT, 0666, false, false, NULL, NULL, NULL, &f) == 0);
+
+        if (seal)
+                *key = setup_seal(f);
+
+        n = now(CLOCK_MONOTONIC);
+
+        for (i = 0; i < N_ENTRIES; i++) {
+                struct iovec iovec[3];
+                struct dual_timestamp ts;
+                char message[DECIMAL_STR_MAX(long) + sizeof("MESSAGE=Test message ")];
+                char rnd[DECIMAL_STR_MAX(long) + sizeof("RANDOM=")];
+
+                dual_timestamp_get(&ts);
+
+                sprintf(message, "MESSAGE=Test message %u", i);
+                sprintf(rnd, "RANDOM=%lu", random() % RANDOM_RANGE);
+
+                IOVEC_SET_STRING(iovec[0], message);
+                IOVEC_SET_STRING(iovec[1], rnd);
+                IOVEC_SET_STRING(iovec[2], "_TRANSPORT=journal");
+
+                assert_se(journal_file_append_entry(f, &ts, iovec, ELEMENTSOF(iovec), NULL, NULL, NULL) == 0);
+        }
+
+        journal_file_close(f);
+
+        return now(CLOCK_MONOTONIC) - n;
+}
+
+int main(int argc, char *argv[]) {
+        char t[] = "/tmp/journal-seal-XXXXXX";
+        _cleanup_free_ char *key = NULL;
+        char a[FORMAT_TIMESPAN_MAX], b[FORMAT_TIMESPAN_MAX];
+        usec_t plain, sealed;
+        JournalFile *f;
+
+        /* journal_file_open requires a valid machine id */
+        if (access("/etc/machine-id", F_OK) != 0)
+                return EXIT_TEST_SKIP;
+
+        log_set_max_level(LOG_INFO);
+
+        assert_se(mkdtemp(t));
+        assert_se(chdir(t) >= 0);
+
+        plain = append_entries("plain.journal", false, NULL);
+        sealed = append_entries("sealed.journal", true, &key);
+
+        log_info("Appended %u entries: unsealed %s (%.0f entries/s), sealed %s (%.0f entries/s)",
+                 N_ENTRIES,
+                 format_timespan(a, sizeof(a), plain, 0), N_ENTRIES / ((double) plain / USEC_PER_SEC),
+                 format_timespan(b, sizeof(b), sealed, 0), N_ENTRIES / ((double) sealed / USEC_PER_SEC));
+
+        /* Make sure the batched authentication still results in
+         * tags that verify */
+        assert_se(journal_file_open("sealed.journal", O_RDONLY, 0666, false, true, NULL, NULL, NULL, &f) == 0);
+        assert_se(JOURNAL_HEADER_SEALED(f->header));
+        assert_se(journal_file_verify(f, key, NULL, NULL, NULL, false) >= 0);
+        journal_file_close(f);
+
+        assert_se(rm_rf_dangerous(t, false, true, false) >= 0);
+
+        return 0;
+}
@@ -180,6 +180,19 @@ int main(int argc, char *argv[]) {
         SD_JOURNAL_FOREACH_UNIQUE(j, data, l)
                 printf("%.*s\n", (int) l, (const char*) data);
 
+        /* Both values show up in all three files, but must be
+         * returned once only, also after restarting */
+        assert_se(sd_journal_query_unique(j, "MAGIC") >= 0);
+        i = 0;
+        SD_JOURNAL_FOREACH_UNIQUE(j, data, l)
+                i++;
+        assert_se(i == 2);
+
+        i = 0;
+        SD_JOURNAL_FOREACH_UNIQUE(j, data, l)
+                i++;
+        assert_se(i == 2);
+
         assert_se(rm_rf_dangerous(t, false, true, false) >= 0);
 
         return 0;
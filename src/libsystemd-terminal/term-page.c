@@ -551,10 +551,24 @@ static void term_cell_append(term_cell *cell, uint32_t ucs4, term_age_t age) {
  * Furthermore, this always sets the character to TERM_CHAR_NULL.
  * If you want to set a specific characters on all cells, you need to hard-code
  * this loop and duplicate the character for each cell.
+ *
+ * As TERM_CHAR_NULL is never allocated, all cells end up bitwise identical.
+ * Therefore, only the first cell is initialized explicitly and then
+ * replicated in chunks of doubling size. This turns clearing of whole lines
+ * into a handful of memcpy() calls, instead of one cell-init per cell.
  */
 static void term_cell_init_n(term_cell *cells, unsigned int n, const term_attr *attr, term_age_t age) {
-        for ( ; n > 0; --n, ++cells)
-                term_cell_init(cells, TERM_CHAR_NULL, 0, attr, age);
+        unsigned int done, chunk;
+
+        if (n < 1)
+                return;
+
+        term_cell_init(cells, TERM_CHAR_NULL, 0, attr, age);
+
+        for (done = 1; done < n; done += chunk) {
+                chunk = MIN(done, n - done);
+                memcpy(cells + done, cells, sizeof(*cells) * chunk);
+        }
 }
 
 /**
@@ -583,8 +597,8 @@ static void term_cell_destroy_n(term_cell *cells, unsigned int n) {
  * this loop and duplicate the character for each cell.
  */
 static void term_cell_clear_n(term_cell *cells, unsigned int n, const term_attr *attr, term_age_t age) {
-        for ( ; n > 0; --n, ++cells)
-                term_cell_set(cells, TERM_CHAR_NULL, 0, attr, age);
+        term_cell_destroy_n(cells, n);
+        term_cell_init_n(cells, n, attr, age);
 }
 
 /**
@@ -1032,17 +1046,23 @@ void term_line_erase(term_line *line, unsigned int from, unsigned int num, const
                 return;
 
         last_protected = 0;
-        for (i = 0; i < num; ++i) {
-                cell = line->cells + from + i;
-                if (keep_protected && cell->attr.protect) {
-                        /* only count protected-cells inside the fill-region */
-                        if (from + i < line->fill)
-                                last_protected = from + i;
 
-                        continue;
-                }
+        /* without protected cells, the whole range is cleared in one go */
+        if (!keep_protected)
+                term_cell_clear_n(line->cells + from, num, attr, age);
+        else {
+                for (i = 0; i < num; ++i) {
+                        cell = line->cells + from + i;
+                        if (cell->attr.protect) {
+                                /* only count protected-cells inside the fill-region */
+                                if (from + i < line->fill)
+                                        last_protected = from + i;
+
+                                continue;
+                        }
 
-                term_cell_set(cell, TERM_CHAR_NULL, 0, attr, age);
+                        term_cell_set(cell, TERM_CHAR_NULL, 0, attr, age);
+                }
         }
 
         /* Adjust fill-state. This is a bit tricks, we can only adjust it in
@@ -1219,6 +1239,34 @@ term_cell *term_page_get_cell(term_page *page, unsigned int x, unsigned int y) {
         return &page->lines[y]->cells[x];
 }
 
+/**
+ * history_recycle() - Take oldest line from a full history
+ * @history: history to work on
+ *
+ * If @history is limited and full, pushing another line into it would free
+ * the top-most line. Instead, this unlinks that line and returns it, so the
+ * caller can reuse it (including its cell-array) in place of a freshly
+ * allocated line. During high-throughput output, this turns each scrolled
+ * line into a simple pointer-shuffle instead of a free()/malloc() cycle.
+ *
+ * Returns: Oldest line of the history, or NULL if the history is not full.
+ */
+static term_line *history_recycle(term_history *history) {
+        term_line *line;
+
+        if (history->max_lines < 1 || history->n_lines < history->max_lines)
+                return NULL;
+
+        line = history->lines_first;
+        if (!line)
+                return NULL;
+
+        TERM_LINE_UNLINK(line, history);
+        --history->n_lines;
+
+        return line;
+}
+
 /**
  * page_scroll_up() - Scroll up
  * @page: page to operate on
@@ -1257,8 +1305,9 @@ static void page_scroll_up(term_page *page, unsigned int new_width, unsigned int
         cache = page->line_cache;
 
         /* Try moving lines into history and allocate new lines for each moved
-         * line. In case allocation fails, or if we have no history, reuse the
-         * line.
+         * line. If the history is full, its oldest line is recycled instead
+         * of allocating a new one. In case allocation fails, or if we have no
+         * history, reuse the line.
          * We keep the lines in the line-cache so we can safely move the
          * remaining lines around. */
         for (i = 0; i < num; ++i) {
@@ -1266,7 +1315,13 @@ static void page_scroll_up(term_page *page, unsigned int new_width, unsigned int
 
                 r = -EAGAIN;
                 if (history) {
-                        r = term_line_new(&cache[i]);
+                        cache[i] = history_recycle(history);
+                        if (cache[i]) {
+                                cache[i]->age = age;
+                                r = 0;
+                        } else
+                                r = term_line_new(&cache[i]);
+
                         if (r >= 0) {
                                 r = term_line_reserve(cache[i],
                                                       new_width,
@@ -451,6 +451,49 @@ static void test_term_line_ops(void) {
         assert_se(!term_line_free(l));
 }
 
+static void test_term_page_throughput(void) {
+        char a[FORMAT_TIMESPAN_MAX];
+        term_history *h;
+        term_page *p;
+        unsigned int i, j;
+        term_age_t age;
+        usec_t n;
+
+        /* Emulate a "cat" of a large log-file: fill each line of an 80x25
+         * page, then scroll it into a limited history. Each full history
+         * recycles its oldest line, and every scroll clears a whole line. */
+
+        assert_se(term_history_new(&h) >= 0);
+        h->max_lines = 1024;
+
+        assert_se(term_page_new(&p) >= 0);
+        assert_se(term_page_reserve(p, 80, 25, NULL, 1) >= 0);
+        term_page_resize(p, 80, 25, NULL, 1, h);
+
+        n = now(CLOCK_MONOTONIC);
+
+        for (i = 0, age = 2; i < 100000; ++i, ++age) {
+                for (j = 0; j < p->width; ++j)
+                        term_page_write(p, j, p->height - 1, PACK1('a' + (i + j) % 26), 1, NULL, age, false);
+
+                term_page_scroll_up(p, 1, NULL, age, h);
+                term_page_erase(p, 0, p->height - 1, p->width, p->height - 1, NULL, age, false);
+        }
+
+        n = now(CLOCK_MONOTONIC) - n;
+
+        log_info("%u lines of %u cells written and scrolled in %s (%.0f lines/s)",
+                 i, p->width, format_timespan(a, sizeof(a), n, 0), i / ((double) n / USEC_PER_SEC));
+
+        /* the last line pushed into history was written p->height scrolls ago */
+        assert_se(h->n_lines == h->max_lines);
+        assert_se(term_char_same(h->lines_last->cells[0].ch, PACK1('a' + (i - p->height) % 26)));
+        assert_se(term_char_is_null(p->lines[p->height - 1]->cells[0].ch));
+
+        term_page_free(p);
+        term_history_free(h);
+}
+
 int main(int argc, char *argv[]) {
         test_term_char_misc();
         test_term_char_packing();
@@ -459,5 +502,7 @@ int main(int argc, char *argv[]) {
         test_term_line_misc();
         test_term_line_ops();
 
+        test_term_page_throughput();
+
         return 0;
 }
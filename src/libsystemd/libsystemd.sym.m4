@@ -443,6 +443,8 @@ global:
         sd_resolve_process;
         sd_resolve_wait;
         sd_resolve_get_tid;
+        sd_resolve_set_cache_usec;
+        sd_resolve_get_cache_stats;
         sd_resolve_attach_event;
         sd_resolve_detach_event;
         sd_resolve_get_event;
@@ -321,6 +321,12 @@ struct sd_bus {
 
         sd_bus_track *track_queue;
 
+        /* All names tracked by any sd_bus_track on this bus, each
+         * mapping to the Set of trackers interested in it, and the
+         * single NameOwnerChanged match dispatching to them */
+        Hashmap *track_names;
+        sd_bus_slot *track_slot;
+
         LIST_HEAD(sd_bus_slot, slots);
 };
 
@@ -4628,6 +4628,23 @@ _public_ int sd_bus_message_read(sd_bus_message *m, const char *types, ...) {
         return r;
 }
 
+static bool message_can_read_array(sd_bus_message *m, const char *contents) {
+        assert(m);
+        assert(contents);
+
+        /* Checks whether an array with the specified element type
+         * can be read in one go with sd_bus_message_read_array(),
+         * rather than element by element */
+
+        if (contents[0] == 0 || contents[1] != 0)
+                return false;
+
+        if (!bus_type_is_trivial(contents[0]))
+                return false;
+
+        return !BUS_MESSAGE_NEED_BSWAP(m) || bus_type_get_size(contents[0]) == 1;
+}
+
 _public_ int sd_bus_message_skip(sd_bus_message *m, const char *types) {
         int r;
 
@@ -4695,21 +4712,32 @@ _public_ int sd_bus_message_skip(sd_bus_message *m, const char *types) {
                         memcpy(s, types+1, k);
                         s[k] = 0;
 
-                        r = sd_bus_message_enter_container(m, SD_BUS_TYPE_ARRAY, s);
-                        if (r <= 0)
-                                return r;
+                        if (message_can_read_array(m, s)) {
+                                const void *p;
+                                size_t l;
 
-                        for (;;) {
-                                r = sd_bus_message_skip(m, s);
+                                /* Arrays of fixed-size elements are
+                                 * skipped as a whole */
+                                r = sd_bus_message_read_array(m, s[0], &p, &l);
+                                if (r <= 0)
+                                        return r;
+                        } else {
+                                r = sd_bus_message_enter_container(m, SD_BUS_TYPE_ARRAY, s);
+                                if (r <= 0)
+                                        return r;
+
+                                for (;;) {
+                                        r = sd_bus_message_skip(m, s);
+                                        if (r < 0)
+                                                return r;
+                                        if (r == 0)
+                                                break;
+                                }
+
+                                r = sd_bus_message_exit_container(m);
                                 if (r < 0)
                                         return r;
-                                if (r == 0)
-                                        break;
                         }
-
-                        r = sd_bus_message_exit_container(m);
-                        if (r < 0)
-                                return r;
                 }
 
                 r = sd_bus_message_skip(m, types + 1 + k);
@@ -4806,7 +4834,7 @@ _public_ int sd_bus_message_read_array(
         assert_return(bus_type_is_trivial(type), -EINVAL);
         assert_return(ptr, -EINVAL);
         assert_return(size, -EINVAL);
-        assert_return(!BUS_MESSAGE_NEED_BSWAP(m), -ENOTSUP);
+        assert_return(!BUS_MESSAGE_NEED_BSWAP(m) || bus_type_get_size(type) == 1, -ENOTSUP);
 
         r = sd_bus_message_enter_container(m, SD_BUS_TYPE_ARRAY, CHAR_TO_STR(type));
         if (r <= 0)
@@ -5724,6 +5752,26 @@ _public_ int sd_bus_message_copy(sd_bus_message *m, sd_bus_message *source, int
 
                 done_something = true;
 
+                /* Arrays of fixed-size elements are copied with a
+                 * single memcpy(). Booleans are excluded, since their
+                 * size differs between dbus1 and GVariant. */
+                if (type == SD_BUS_TYPE_ARRAY &&
+                    contents[0] != SD_BUS_TYPE_BOOLEAN &&
+                    message_can_read_array(source, contents)) {
+                        const void *p;
+                        size_t l;
+
+                        r = sd_bus_message_read_array(source, contents[0], &p, &l);
+                        if (r < 0)
+                                return r;
+
+                        r = sd_bus_message_append_array(m, contents[0], p, l);
+                        if (r < 0)
+                                return r;
+
+                        continue;
+                }
+
                 if (bus_type_is_container(type) > 0) {
 
                         r = sd_bus_message_enter_container(source, type, contents);
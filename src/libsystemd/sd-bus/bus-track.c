@@ -21,6 +21,7 @@
 
 #include "sd-bus.h"
 #include "set.h"
+#include "strv.h"
 #include "bus-util.h"
 #include "bus-internal.h"
 #include "bus-track.h"
@@ -30,32 +31,23 @@ struct sd_bus_track {
         sd_bus *bus;
         sd_bus_track_handler_t handler;
         void *userdata;
-        Hashmap *names;
+        Set *names;
         LIST_FIELDS(sd_bus_track, queue);
         Iterator iterator;
         bool in_queue;
         bool modified;
 };
 
-#define MATCH_PREFIX                                        \
+/* A single match for all NameOwnerChanged signals is shared by all
+ * trackers of a bus. Installing one match per tracked name would
+ * mean a synchronous AddMatch() round-trip for each, and a long list
+ * of matches for the bus daemon to check every message against. */
+#define MATCH_NAME_OWNER_CHANGED                            \
         "type='signal',"                                    \
         "sender='org.freedesktop.DBus',"                    \
         "path='/org/freedesktop/DBus',"                     \
         "interface='org.freedesktop.DBus',"                 \
-        "member='NameOwnerChanged',"                        \
-        "arg0='"
-
-#define MATCH_SUFFIX \
-        "'"
-
-#define MATCH_FOR_NAME(name)                                            \
-        ({                                                              \
-                char *_x;                                               \
-                size_t _l = strlen(name);                               \
-                _x = alloca(strlen(MATCH_PREFIX)+_l+strlen(MATCH_SUFFIX)+1); \
-                strcpy(stpcpy(stpcpy(_x, MATCH_PREFIX), name), MATCH_SUFFIX); \
-                _x;                                                     \
-        })
+        "member='NameOwnerChanged'"
 
 static void bus_track_add_to_queue(sd_bus_track *track) {
         assert(track);
@@ -129,11 +121,11 @@ _public_ sd_bus_track* sd_bus_track_unref(sd_bus_track *track) {
                 return NULL;
         }
 
-        while ((n = hashmap_first_key(track->names)))
+        while ((n = set_first(track->names)))
                 sd_bus_track_remove_name(track, n);
 
         bus_track_remove_from_queue(track);
-        hashmap_free(track->names);
+        set_free(track->names);
         sd_bus_unref(track->bus);
         free(track);
 
@@ -141,32 +133,110 @@ _public_ sd_bus_track* sd_bus_track_unref(sd_bus_track *track) {
 }
 
 static int on_name_owner_changed(sd_bus *bus, sd_bus_message *message, void *userdata, sd_bus_error *error) {
-        sd_bus_track *track = userdata;
+        sd_bus_track *track;
         const char *name, *old, *new;
+        Set *s;
         int r;
 
         assert(bus);
         assert(message);
-        assert(track);
 
         r = sd_bus_message_read(message, "sss", &name, &old, &new);
         if (r < 0)
                 return 0;
 
-        sd_bus_track_remove_name(track, name);
+        /* Dropping the name from the last tracker also removes the
+         * set from the table, which terminates the loop */
+        while ((s = hashmap_get(bus->track_names, name)) &&
+               (track = set_first(s)))
+                sd_bus_track_remove_name(track, name);
+
         return 0;
 }
 
+static int bus_track_name_ref(sd_bus_track *track, const char *name) {
+        sd_bus *bus = track->bus;
+        _cleanup_free_ char *n = NULL;
+        _cleanup_set_free_ Set *s = NULL;
+        Set *existing;
+        int r;
+
+        existing = hashmap_get(bus->track_names, name);
+        if (existing)
+                return set_put(existing, track);
+
+        r = hashmap_ensure_allocated(&bus->track_names, &string_hash_ops);
+        if (r < 0)
+                return r;
+
+        n = strdup(name);
+        if (!n)
+                return -ENOMEM;
+
+        s = set_new(NULL);
+        if (!s)
+                return -ENOMEM;
+
+        r = set_put(s, track);
+        if (r < 0)
+                return r;
+
+        /* Subscribe before the first name is added to the table, so
+         * that no change of its owner can be missed */
+        if (!bus->track_slot) {
+                r = sd_bus_add_match(bus, &bus->track_slot, MATCH_NAME_OWNER_CHANGED, on_name_owner_changed, NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        r = hashmap_put(bus->track_names, n, s);
+        if (r < 0) {
+                if (hashmap_isempty(bus->track_names))
+                        bus->track_slot = sd_bus_slot_unref(bus->track_slot);
+                return r;
+        }
+
+        n = NULL;
+        s = NULL;
+
+        return 1;
+}
+
+static void bus_track_name_unref(sd_bus_track *track, const char *name) {
+        sd_bus *bus = track->bus;
+        char *n = NULL;
+        Set *s;
+
+        s = hashmap_get2(bus->track_names, name, (void**) &n);
+        if (!s)
+                return;
+
+        set_remove(s, track);
+        if (!set_isempty(s))
+                return;
+
+        hashmap_remove(bus->track_names, name);
+        set_free(s);
+        free(n);
+
+        /* Unsubscribe once nobody is tracking anything anymore on
+         * this bus. This also drops the reference the match holds on
+         * the bus. */
+        if (hashmap_isempty(bus->track_names))
+                bus->track_slot = sd_bus_slot_unref(bus->track_slot);
+}
+
 _public_ int sd_bus_track_add_name(sd_bus_track *track, const char *name) {
-        _cleanup_bus_slot_unref_ sd_bus_slot *slot = NULL;
         _cleanup_free_ char *n = NULL;
-        const char *match;
         int r;
 
         assert_return(track, -EINVAL);
         assert_return(service_name_is_valid(name), -EINVAL);
 
-        r = hashmap_ensure_allocated(&track->names, &string_hash_ops);
+        if (set_contains(track->names, name))
+                return 0;
+
+        r = set_ensure_allocated(&track->names, &string_hash_ops);
         if (r < 0)
                 return r;
 
@@ -175,27 +245,26 @@ _public_ int sd_bus_track_add_name(sd_bus_track *track, const char *name) {
                 return -ENOMEM;
 
         /* First, subscribe to this name */
-        match = MATCH_FOR_NAME(n);
-        r = sd_bus_add_match(track->bus, &slot, match, on_name_owner_changed, track);
+        r = bus_track_name_ref(track, n);
         if (r < 0)
                 return r;
 
-        r = hashmap_put(track->names, n, slot);
-        if (r == -EEXIST)
-                return 0;
-        if (r < 0)
+        r = set_put(track->names, n);
+        if (r < 0) {
+                bus_track_name_unref(track, n);
                 return r;
+        }
 
         /* Second, check if it is currently existing, or maybe
          * doesn't, or maybe disappeared already. */
         r = sd_bus_get_name_creds(track->bus, n, 0, NULL);
         if (r < 0) {
-                hashmap_remove(track->names, n);
+                set_remove(track->names, n);
+                bus_track_name_unref(track, n);
                 return r;
         }
 
         n = NULL;
-        slot = NULL;
 
         bus_track_remove_from_queue(track);
         track->modified = true;
@@ -203,8 +272,29 @@ _public_ int sd_bus_track_add_name(sd_bus_track *track, const char *name) {
         return 1;
 }
 
+int bus_track_add_names(sd_bus_track *track, char **names) {
+        char **i;
+        int r = 0;
+
+        assert(track);
+
+        /* Adds all names, even if some of them fail. Since the
+         * NameOwnerChanged match is shared, this costs one
+         * existence check per name, and at most a single AddMatch()
+         * for the whole batch. */
+
+        STRV_FOREACH(i, names) {
+                int k;
+
+                k = sd_bus_track_add_name(track, *i);
+                if (k < 0)
+                        r = k;
+        }
+
+        return r;
+}
+
 _public_ int sd_bus_track_remove_name(sd_bus_track *track, const char *name) {
-        _cleanup_bus_slot_unref_ sd_bus_slot *slot = NULL;
         _cleanup_free_ char *n = NULL;
 
         assert_return(name, -EINVAL);
@@ -212,11 +302,13 @@ _public_ int sd_bus_track_remove_name(sd_bus_track *track, const char *name) {
         if (!track)
                 return 0;
 
-        slot = hashmap_remove2(track->names, (char*) name, (void**) &n);
-        if (!slot)
+        n = set_remove(track->names, (char*) name);
+        if (!n)
                 return 0;
 
-        if (hashmap_isempty(track->names))
+        bus_track_name_unref(track, n);
+
+        if (set_isempty(track->names))
                 bus_track_add_to_queue(track);
 
         track->modified = true;
@@ -228,40 +320,34 @@ _public_ unsigned sd_bus_track_count(sd_bus_track *track) {
         if (!track)
                 return 0;
 
-        return hashmap_size(track->names);
+        return set_size(track->names);
 }
 
 _public_ const char* sd_bus_track_contains(sd_bus_track *track, const char *name) {
         assert_return(track, NULL);
         assert_return(name, NULL);
 
-        return hashmap_get(track->names, (void*) name) ? name : NULL;
+        return set_contains(track->names, name) ? name : NULL;
 }
 
 _public_ const char* sd_bus_track_first(sd_bus_track *track) {
-        const char *n = NULL;
-
         if (!track)
                 return NULL;
 
         track->modified = false;
         track->iterator = ITERATOR_FIRST;
 
-        hashmap_iterate(track->names, &track->iterator, (const void**) &n);
-        return n;
+        return set_iterate(track->names, &track->iterator);
 }
 
 _public_ const char* sd_bus_track_next(sd_bus_track *track) {
-        const char *n = NULL;
-
         if (!track)
                 return NULL;
 
         if (track->modified)
                 return NULL;
 
-        hashmap_iterate(track->names, &track->iterator, (const void**) &n);
-        return n;
+        return set_iterate(track->names, &track->iterator);
 }
 
 _public_ int sd_bus_track_add_sender(sd_bus_track *track, sd_bus_message *m) {
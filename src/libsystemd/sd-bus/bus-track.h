@@ -22,3 +22,4 @@
 ***/
 
 void bus_track_dispatch(sd_bus_track *track);
+int bus_track_add_names(sd_bus_track *track, char **names);
@@ -95,6 +95,8 @@ static void bus_free(sd_bus *b) {
 
         assert(b);
         assert(!b->track_queue);
+        assert(hashmap_isempty(b->track_names));
+        assert(!b->track_slot);
 
         b->state = BUS_CLOSED;
 
@@ -132,6 +134,8 @@ static void bus_free(sd_bus *b) {
         free(b->cgroup_root);
         free(b->description);
 
+        hashmap_free(b->track_names);
+
         free(b->exec_path);
         strv_free(b->exec_argv);
 
@@ -81,6 +81,56 @@ static void test_bus_label_escape(void) {
         test_bus_label_escape_one(":1", "_3a1");
 }
 
+static void test_bus_fixed_array(sd_bus *bus) {
+        _cleanup_bus_message_unref_ sd_bus_message *m = NULL, *copy = NULL;
+        _cleanup_free_ uint32_t *data = NULL;
+        char a[FORMAT_TIMESPAN_MAX], b[FORMAT_TIMESPAN_MAX];
+        const uint32_t *p;
+        const char *x;
+        usec_t t, t_copy, t_skip;
+        size_t i, n = 1024*1024, l;
+
+        /* Large arrays of fixed-size elements are copied and skipped
+         * as a whole */
+
+        data = new(uint32_t, n);
+        assert_se(data);
+
+        for (i = 0; i < n; i++)
+                data[i] = i;
+
+        assert_se(sd_bus_message_new_method_call(bus, &m, "foobar.waldo", "/", "foobar.waldo", "Array") >= 0);
+        assert_se(sd_bus_message_append_array(m, 'u', data, n * sizeof(uint32_t)) >= 0);
+        assert_se(sd_bus_message_append(m, "s", "tail") >= 0);
+        assert_se(bus_message_seal(m, 4713, 0) >= 0);
+
+        assert_se(sd_bus_message_new_method_call(bus, &copy, "foobar.waldo", "/", "foobar.waldo", "Array") >= 0);
+
+        t = now(CLOCK_MONOTONIC);
+        assert_se(sd_bus_message_copy(copy, m, true) >= 0);
+        t_copy = now(CLOCK_MONOTONIC) - t;
+
+        assert_se(bus_message_seal(copy, 4714, 0) >= 0);
+
+        assert_se(sd_bus_message_read_array(copy, 'u', (const void**) &p, &l) > 0);
+        assert_se(l == n * sizeof(uint32_t));
+        assert_se(memcmp(p, data, l) == 0);
+        assert_se(sd_bus_message_read(copy, "s", &x) > 0);
+        assert_se(streq(x, "tail"));
+
+        assert_se(sd_bus_message_rewind(m, true) >= 0);
+
+        t = now(CLOCK_MONOTONIC);
+        assert_se(sd_bus_message_skip(m, "au") > 0);
+        t_skip = now(CLOCK_MONOTONIC) - t;
+
+        assert_se(sd_bus_message_read(m, "s", &x) > 0);
+        assert_se(streq(x, "tail"));
+
+        log_info("Array of %zu uint32_t: copied in %s, skipped in %s",
+                 n, format_timespan(a, sizeof(a), t_copy, 0), format_timespan(b, sizeof(b), t_skip, 0));
+}
+
 int main(int argc, char *argv[]) {
         _cleanup_bus_message_unref_ sd_bus_message *m = NULL, *copy = NULL;
         int r, boolean;
@@ -357,6 +407,8 @@ int main(int argc, char *argv[]) {
         assert_se(streq(c, "ccc"));
         assert_se(streq(d, "3"));
 
+        test_bus_fixed_array(bus);
+
         test_bus_label_escape();
         test_bus_path_encode();
 
@@ -44,6 +44,8 @@
 
 #include "util.h"
 #include "list.h"
+#include "hashmap.h"
+#include "siphash24.h"
 #include "socket-util.h"
 #include "missing.h"
 #include "resolve-util.h"
@@ -53,6 +55,7 @@
 #define WORKERS_MAX 16U
 #define QUERIES_MAX 256U
 #define BUFSIZE 10240U
+#define CACHE_ENTRIES_MAX 128U
 
 typedef enum {
         REQUEST_ADDRINFO,
@@ -97,6 +100,13 @@ struct sd_resolve {
         sd_resolve **default_resolve_ptr;
         pid_t tid;
 
+        /* getaddrinfo() result cache, shared by the worker threads
+         * and protected by cache_mutex */
+        pthread_mutex_t cache_mutex;
+        Hashmap *cache;
+        usec_t cache_usec;
+        unsigned n_cache_hits, n_cache_misses;
+
         LIST_HEAD(sd_resolve_query, queries);
 };
 
@@ -191,6 +201,18 @@ typedef struct ResResponse {
         int _h_errno;
 } ResResponse;
 
+typedef struct CacheEntry {
+        usec_t until;
+
+        /* The request packet, minus its header, is the key */
+        void *request;
+        size_t request_size;
+
+        /* The complete serialized AddrInfoResponse */
+        void *response;
+        size_t response_size;
+} CacheEntry;
+
 typedef union Packet {
         RHeader rheader;
         AddrInfoRequest addrinfo_request;
@@ -257,9 +279,174 @@ static void *serialize_addrinfo(void *p, const struct addrinfo *ai, size_t *leng
         return (uint8_t*) p + l;
 }
 
+static unsigned long cache_entry_hash_func(const void *p, const uint8_t hash_key[HASH_KEY_SIZE]) {
+        const CacheEntry *e = p;
+        uint64_t u;
+
+        siphash24((uint8_t*) &u, e->request, e->request_size, hash_key);
+
+        return (unsigned long) u;
+}
+
+static int cache_entry_compare_func(const void *a, const void *b) {
+        const CacheEntry *x = a, *y = b;
+
+        if (x->request_size != y->request_size)
+                return x->request_size < y->request_size ? -1 : 1;
+
+        return memcmp(x->request, y->request, x->request_size);
+}
+
+static const struct hash_ops cache_entry_hash_ops = {
+        .hash = cache_entry_hash_func,
+        .compare = cache_entry_compare_func
+};
+
+static void cache_entry_free(CacheEntry *e) {
+        if (!e)
+                return;
+
+        free(e->request);
+        free(e->response);
+        free(e);
+}
+
+static void cache_flush(Hashmap *cache, usec_t n) {
+        CacheEntry *e;
+        Iterator i;
+
+        /* Drops all entries that expired before n */
+
+        HASHMAP_FOREACH(e, cache, i)
+                if (e->until <= n) {
+                        hashmap_remove(cache, e);
+                        cache_entry_free(e);
+                }
+}
+
+static bool cache_lookup(sd_resolve *resolve, const AddrInfoRequest *req, void *buffer, size_t *size) {
+        CacheEntry key, *e;
+
+        assert(resolve);
+        assert(req);
+        assert(buffer);
+        assert(size);
+
+        /* Called from the worker threads. Copies a cached response
+         * into the buffer, so that it can be sent without holding
+         * the lock. */
+
+        key.request = (uint8_t*) req + sizeof(RHeader);
+        key.request_size = req->header.length - sizeof(RHeader);
+
+        assert_se(pthread_mutex_lock(&resolve->cache_mutex) == 0);
+
+        e = hashmap_get(resolve->cache, &key);
+        if (e && e->until > now(CLOCK_MONOTONIC) && e->response_size <= *size) {
+                memcpy(buffer, e->response, e->response_size);
+                *size = e->response_size;
+                resolve->n_cache_hits++;
+        } else {
+                resolve->n_cache_misses++;
+                e = NULL;
+        }
+
+        assert_se(pthread_mutex_unlock(&resolve->cache_mutex) == 0);
+
+        return !!e;
+}
+
+static bool cache_enabled(sd_resolve *resolve) {
+        bool b;
+
+        assert(resolve);
+
+        /* Called from the worker threads, cache_usec may be changed
+         * by the main thread at any time */
+
+        assert_se(pthread_mutex_lock(&resolve->cache_mutex) == 0);
+        b = resolve->cache_usec > 0;
+        assert_se(pthread_mutex_unlock(&resolve->cache_mutex) == 0);
+
+        return b;
+}
+
+static void cache_put(sd_resolve *resolve, const AddrInfoRequest *req, const struct iovec *iov, unsigned n_iov) {
+        CacheEntry *e, *old;
+        unsigned i;
+        size_t l = 0;
+        usec_t n;
+
+        assert(resolve);
+        assert(req);
+        assert(iov);
+
+        /* Called from the worker threads, failing to add an entry
+         * is not fatal, hence errors are ignored here */
+
+        e = new0(CacheEntry, 1);
+        if (!e)
+                return;
+
+        e->request_size = req->header.length - sizeof(RHeader);
+        e->request = memdup((uint8_t*) req + sizeof(RHeader), e->request_size);
+        if (!e->request)
+                goto fail;
+
+        for (i = 0; i < n_iov; i++)
+                e->response_size += iov[i].iov_len;
+
+        e->response = malloc(e->response_size);
+        if (!e->response)
+                goto fail;
+
+        for (i = 0; i < n_iov; i++) {
+                memcpy((uint8_t*) e->response + l, iov[i].iov_base, iov[i].iov_len);
+                l += iov[i].iov_len;
+        }
+
+        n = now(CLOCK_MONOTONIC);
+
+        assert_se(pthread_mutex_lock(&resolve->cache_mutex) == 0);
+
+        /* The cache might have been disabled in the meantime */
+        if (resolve->cache_usec <= 0)
+                goto unlock;
+
+        e->until = n + resolve->cache_usec;
+
+        if (hashmap_ensure_allocated(&resolve->cache, &cache_entry_hash_ops) < 0)
+                goto unlock;
+
+        old = hashmap_remove(resolve->cache, e);
+        cache_entry_free(old);
+
+        if (hashmap_size(resolve->cache) >= CACHE_ENTRIES_MAX)
+                cache_flush(resolve->cache, n);
+
+        if (hashmap_size(resolve->cache) < CACHE_ENTRIES_MAX &&
+            hashmap_put(resolve->cache, e, e) >= 0)
+                e = NULL;
+
+unlock:
+        assert_se(pthread_mutex_unlock(&resolve->cache_mutex) == 0);
+
+fail:
+        cache_entry_free(e);
+}
+
+static bool addrinfo_result_cacheable(int ret) {
+
+        /* Only cache successful lookups and definitive negative
+         * replies, never transient failures */
+
+        return IN_SET(ret, 0, EAI_NONAME, EAI_SERVICE);
+}
+
 static int send_addrinfo_reply(
+                sd_resolve *resolve,
                 int out_fd,
-                unsigned id,
+                const AddrInfoRequest *req,
                 int ret,
                 struct addrinfo *ai,
                 int _errno,
@@ -267,7 +454,7 @@ static int send_addrinfo_reply(
 
         AddrInfoResponse resp = {
                 .header.type = RESPONSE_ADDRINFO,
-                .header.id = id,
+                .header.id = req->header.id,
                 .header.length = sizeof(AddrInfoResponse),
                 .ret = ret,
                 ._errno = _errno,
@@ -281,6 +468,7 @@ static int send_addrinfo_reply(
                 uint8_t space[BUFSIZE];
         } buffer;
 
+        assert(resolve);
         assert(out_fd >= 0);
 
         if (ret == 0 && ai) {
@@ -302,6 +490,9 @@ static int send_addrinfo_reply(
         iov[0] = (struct iovec) { .iov_base = &resp, .iov_len = sizeof(AddrInfoResponse) };
         iov[1] = (struct iovec) { .iov_base = &buffer, .iov_len = resp.header.length - sizeof(AddrInfoResponse) };
 
+        if (addrinfo_result_cacheable(ret) && cache_enabled(resolve))
+                cache_put(resolve, req, iov, ELEMENTSOF(iov));
+
         mh.msg_iov = iov;
         mh.msg_iovlen = ELEMENTSOF(iov);
 
@@ -311,6 +502,21 @@ static int send_addrinfo_reply(
         return 0;
 }
 
+static int send_cached_addrinfo_reply(int out_fd, unsigned id, void *response, size_t size) {
+        AddrInfoResponse *resp = response;
+
+        assert(out_fd >= 0);
+        assert(response);
+        assert(size >= sizeof(AddrInfoResponse));
+
+        resp->header.id = id;
+
+        if (send(out_fd, response, size, MSG_NOSIGNAL) < 0)
+                return -errno;
+
+        return 0;
+}
+
 static int send_nameinfo_reply(
                 int out_fd,
                 unsigned id,
@@ -386,9 +592,10 @@ static int send_res_reply(int out_fd, unsigned id, const unsigned char *answer,
         return 0;
 }
 
-static int handle_request(int out_fd, const Packet *packet, size_t length) {
+static int handle_request(sd_resolve *resolve, int out_fd, const Packet *packet, size_t length) {
         const RHeader *req;
 
+        assert(resolve);
         assert(out_fd >= 0);
         assert(packet);
 
@@ -408,6 +615,17 @@ static int handle_request(int out_fd, const Packet *packet, size_t length) {
                assert(length >= sizeof(AddrInfoRequest));
                assert(length == sizeof(AddrInfoRequest) + ai_req->node_len + ai_req->service_len);
 
+               if (cache_enabled(resolve)) {
+                       union {
+                               AddrInfoResponse response;
+                               uint8_t space[BUFSIZE];
+                       } cached;
+                       size_t size = sizeof(cached);
+
+                       if (cache_lookup(resolve, ai_req, &cached, &size))
+                               return send_cached_addrinfo_reply(out_fd, req->id, &cached, size);
+               }
+
                hints.ai_flags = ai_req->ai_flags;
                hints.ai_family = ai_req->ai_family;
                hints.ai_socktype = ai_req->ai_socktype;
@@ -422,7 +640,7 @@ static int handle_request(int out_fd, const Packet *packet, size_t length) {
                                &result);
 
                /* send_addrinfo_reply() frees result */
-               return send_addrinfo_reply(out_fd, req->id, ret, result, errno, h_errno);
+               return send_addrinfo_reply(resolve, out_fd, ai_req, ret, result, errno, h_errno);
         }
 
         case REQUEST_NAMEINFO: {
@@ -513,7 +731,7 @@ static void* thread_worker(void *p) {
                 if (resolve->dead)
                         break;
 
-                if (handle_request(resolve->fds[RESPONSE_SEND_FD], &buf.packet, (size_t) length) < 0)
+                if (handle_request(resolve, resolve->fds[RESPONSE_SEND_FD], &buf.packet, (size_t) length) < 0)
                         break;
         }
 
@@ -566,6 +784,8 @@ _public_ int sd_resolve_new(sd_resolve **ret) {
         for (i = 0; i < _FD_MAX; i++)
                 resolve->fds[i] = -1;
 
+        assert_se(pthread_mutex_init(&resolve->cache_mutex, NULL) == 0);
+
         r = socketpair(PF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC, 0, resolve->fds + REQUEST_RECV_FD);
         if (r < 0) {
                 r = -errno;
@@ -679,6 +899,10 @@ static void resolve_free(sd_resolve *resolve) {
         for (i = 0; i < _FD_MAX; i++)
                 safe_close(resolve->fds[i]);
 
+        cache_flush(resolve->cache, USEC_INFINITY);
+        hashmap_free(resolve->cache);
+        pthread_mutex_destroy(&resolve->cache_mutex);
+
         free(resolve);
 }
 
@@ -705,6 +929,37 @@ _public_ sd_resolve* sd_resolve_unref(sd_resolve *resolve) {
         return NULL;
 }
 
+_public_ int sd_resolve_set_cache_usec(sd_resolve *resolve, uint64_t usec) {
+        assert_return(resolve, -EINVAL);
+        assert_return(!resolve_pid_changed(resolve), -ECHILD);
+
+        assert_se(pthread_mutex_lock(&resolve->cache_mutex) == 0);
+
+        resolve->cache_usec = usec;
+        if (usec <= 0)
+                cache_flush(resolve->cache, USEC_INFINITY);
+
+        assert_se(pthread_mutex_unlock(&resolve->cache_mutex) == 0);
+
+        return 0;
+}
+
+_public_ int sd_resolve_get_cache_stats(sd_resolve *resolve, unsigned *hits, unsigned *misses) {
+        assert_return(resolve, -EINVAL);
+        assert_return(!resolve_pid_changed(resolve), -ECHILD);
+
+        assert_se(pthread_mutex_lock(&resolve->cache_mutex) == 0);
+
+        if (hits)
+                *hits = resolve->n_cache_hits;
+        if (misses)
+                *misses = resolve->n_cache_misses;
+
+        assert_se(pthread_mutex_unlock(&resolve->cache_mutex) == 0);
+
+        return 0;
+}
+
 _public_ int sd_resolve_get_fd(sd_resolve *resolve) {
         assert_return(resolve, -EINVAL);
         assert_return(!resolve_pid_changed(resolve), -ECHILD);
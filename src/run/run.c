@@ -818,31 +818,19 @@ static int start_transient_service(
         return 0;
 }
 
-static int start_transient_scope(
+static int transient_scope_call(
                 sd_bus *bus,
-                char **argv) {
+                const char *scope,
+                bool many,
+                sd_bus_error *error,
+                sd_bus_message **reply) {
 
-        _cleanup_bus_error_free_ sd_bus_error error = SD_BUS_ERROR_NULL;
-        _cleanup_bus_message_unref_ sd_bus_message *m = NULL, *reply = NULL;
-        _cleanup_(bus_wait_for_jobs_freep) BusWaitForJobs *w = NULL;
-        _cleanup_strv_free_ char **env = NULL, **user_env = NULL;
-        _cleanup_free_ char *scope = NULL;
-        const char *object = NULL;
+        _cleanup_bus_message_unref_ sd_bus_message *m = NULL;
         int r;
 
         assert(bus);
-        assert(argv);
-
-        r = bus_wait_for_jobs_new(bus, &w);
-        if (r < 0)
-                return log_oom();
-
-        if (arg_unit) {
-                scope = unit_name_mangle_with_suffix(arg_unit, MANGLE_NOGLOB, ".scope");
-                if (!scope)
-                        return log_oom();
-        } else if (asprintf(&scope, "run-"PID_FMT".scope", getpid()) < 0)
-                return log_oom();
+        assert(scope);
+        assert(reply);
 
         r = sd_bus_message_new_method_call(
                         bus,
@@ -850,12 +838,28 @@ static int start_transient_scope(
                         "org.freedesktop.systemd1",
                         "/org/freedesktop/systemd1",
                         "org.freedesktop.systemd1.Manager",
-                        "StartTransientUnit");
+                        many ? "StartTransientUnits" : "StartTransientUnit");
         if (r < 0)
                 return bus_log_create_error(r);
 
-        /* Name and Mode */
-        r = sd_bus_message_append(m, "ss", scope, "fail");
+        if (many) {
+                /* Mode, runtime flag and the scope as only unit */
+                r = sd_bus_message_append(m, "sb", "fail", true);
+                if (r < 0)
+                        return bus_log_create_error(r);
+
+                r = sd_bus_message_open_container(m, 'a', "(sa(sv))");
+                if (r < 0)
+                        return bus_log_create_error(r);
+
+                r = sd_bus_message_open_container(m, 'r', "sa(sv)");
+                if (r < 0)
+                        return bus_log_create_error(r);
+
+                r = sd_bus_message_append(m, "s", scope);
+        } else
+                /* Name and Mode */
+                r = sd_bus_message_append(m, "ss", scope, "fail");
         if (r < 0)
                 return bus_log_create_error(r);
 
@@ -872,12 +876,71 @@ static int start_transient_scope(
         if (r < 0)
                 return bus_log_create_error(r);
 
+        if (many) {
+                r = sd_bus_message_close_container(m);
+                if (r < 0)
+                        return bus_log_create_error(r);
+
+                r = sd_bus_message_close_container(m);
+                if (r < 0)
+                        return bus_log_create_error(r);
+        }
+
         /* Auxiliary units */
         r = sd_bus_message_append(m, "a(sa(sv))", 0);
         if (r < 0)
                 return bus_log_create_error(r);
 
-        r = sd_bus_call(bus, m, 0, &error, &reply);
+        r = sd_bus_call(bus, m, 0, error, reply);
+        if (r < 0)
+                return r;
+
+        if (many) {
+                r = sd_bus_message_enter_container(*reply, 'a', "o");
+                if (r < 0)
+                        return bus_log_parse_error(r);
+        }
+
+        return 0;
+}
+
+static int start_transient_scope(
+                sd_bus *bus,
+                char **argv) {
+
+        _cleanup_bus_error_free_ sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_bus_message_unref_ sd_bus_message *reply = NULL;
+        _cleanup_(bus_wait_for_jobs_freep) BusWaitForJobs *w = NULL;
+        _cleanup_strv_free_ char **env = NULL, **user_env = NULL;
+        _cleanup_free_ char *scope = NULL;
+        const char *object = NULL;
+        int r;
+
+        assert(bus);
+        assert(argv);
+
+        r = bus_wait_for_jobs_new(bus, &w);
+        if (r < 0)
+                return log_oom();
+
+        if (arg_unit) {
+                scope = unit_name_mangle_with_suffix(arg_unit, MANGLE_NOGLOB, ".scope");
+                if (!scope)
+                        return log_oom();
+        } else if (asprintf(&scope, "run-"PID_FMT".scope", getpid()) < 0)
+                return log_oom();
+
+        /* Fall back to the single unit call on managers that don't
+         * know (or don't let us call) StartTransientUnits(). */
+        r = transient_scope_call(bus, scope, true, &error, &reply);
+        if (r < 0) {
+                log_debug("Failed to start transient scope unit, retrying with StartTransientUnit(): %s", bus_error_message(&error, -r));
+
+                sd_bus_error_free(&error);
+                reply = sd_bus_message_unref(reply);
+
+                r = transient_scope_call(bus, scope, false, &error, &reply);
+        }
         if (r < 0) {
                 log_error("Failed to start transient scope unit: %s", bus_error_message(&error, -r));
                 return r;
@@ -941,9 +1004,12 @@ static int start_transient_scope(
         if (r < 0)
                 return bus_log_parse_error(r);
 
-        r = bus_wait_for_jobs_one(w, object, arg_quiet);
-        if (r < 0)
-                return r;
+        /* StartTransientUnits() replies "/" if no job was needed */
+        if (!streq(object, "/")) {
+                r = bus_wait_for_jobs_one(w, object, arg_quiet);
+                if (r < 0)
+                        return r;
+        }
 
         if (!arg_quiet)
                 log_info("Running scope as unit %s.", scope);
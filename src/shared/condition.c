@@ -39,6 +39,17 @@
 #include "audit.h"
 #include "condition.h"
 #include "cap-list.h"
+#include "hashmap.h"
+#include "strv.h"
+
+/* While a batch of units is being started, the results of conditions
+ * that don't depend on anything other units might change are memoized
+ * by type and parameter, see condition_cache_begin(). The split up
+ * kernel command line is kept for the batch too. */
+static thread_local bool cache_active = false;
+static thread_local Hashmap *cache = NULL;
+static thread_local char **cached_cmdline = NULL;
+static thread_local unsigned cache_hits = 0;
 
 Condition* condition_new(ConditionType type, const char *parameter, bool trigger, bool negate) {
         Condition *c;
@@ -82,8 +93,8 @@ Condition* condition_free_list(Condition *first) {
 }
 
 static int condition_test_kernel_command_line(Condition *c) {
-        _cleanup_free_ char *line = NULL;
-        const char *p;
+        _cleanup_strv_free_ char **words = NULL;
+        char **l, **word;
         bool equal;
         int r;
 
@@ -91,29 +102,35 @@ static int condition_test_kernel_command_line(Condition *c) {
         assert(c->parameter);
         assert(c->type == CONDITION_KERNEL_COMMAND_LINE);
 
-        r = proc_cmdline(&line);
-        if (r < 0)
-                return r;
-
-        equal = !!strchr(c->parameter, '=');
-        p = line;
+        l = cache_active ? cached_cmdline : NULL;
+        if (!l) {
+                _cleanup_free_ char *line = NULL;
 
-        for (;;) {
-                _cleanup_free_ char *word = NULL;
-                bool found;
+                r = proc_cmdline(&line);
+                if (r < 0)
+                        return r;
 
-                r = unquote_first_word(&p, &word, true);
+                r = strv_split_quoted(&l, line, true);
                 if (r < 0)
                         return r;
-                if (r == 0)
-                        break;
+
+                if (cache_active)
+                        cached_cmdline = l;
+                else
+                        words = l;
+        }
+
+        equal = !!strchr(c->parameter, '=');
+
+        STRV_FOREACH(word, l) {
+                bool found;
 
                 if (equal)
-                        found = streq(word, c->parameter);
+                        found = streq(*word, c->parameter);
                 else {
                         const char *f;
 
-                        f = startswith(word, c->parameter);
+                        f = startswith(*word, c->parameter);
                         found = f && (*f == '=' || *f == 0);
                 }
 
@@ -429,13 +446,50 @@ int condition_test(Condition *c) {
                 [CONDITION_NULL] = condition_test_null,
         };
 
+        _cleanup_free_ char *key = NULL;
         int r, b;
 
         assert(c);
         assert(c->type >= 0);
         assert(c->type < _CONDITION_TYPE_MAX);
 
-        r = condition_tests[c->type](c);
+        /* Only conditions on the system itself are memoized. The
+         * ones on paths, AC power and friends are always checked
+         * again: jobs of targets, sockets or paths complete
+         * synchronously within the same batch, and the units
+         * ordered after them might depend on what they did. */
+        if (cache_active &&
+            IN_SET(c->type,
+                   CONDITION_ARCHITECTURE,
+                   CONDITION_VIRTUALIZATION,
+                   CONDITION_HOST,
+                   CONDITION_KERNEL_COMMAND_LINE,
+                   CONDITION_SECURITY,
+                   CONDITION_CAPABILITY)) {
+                void *v;
+
+                if (asprintf(&key, "%i:%s", c->type, c->parameter) < 0)
+                        return -ENOMEM;
+
+                /* Values are stored off by one, to tell "false"
+                 * apart from "not cached" */
+                v = hashmap_get(cache, key);
+                if (v) {
+                        r = PTR_TO_INT(v) - 1;
+                        cache_hits++;
+                } else {
+                        r = condition_tests[c->type](c);
+
+                        /* Failures are not cached, they might be
+                         * temporary */
+                        if (r >= 0 &&
+                            hashmap_ensure_allocated(&cache, &string_hash_ops) >= 0 &&
+                            hashmap_put(cache, key, INT_TO_PTR((r > 0) + 1)) >= 0)
+                                key = NULL;
+                }
+        } else
+                r = condition_tests[c->type](c);
+
         if (r < 0) {
                 c->result = CONDITION_ERROR;
                 return r;
@@ -446,6 +500,41 @@ int condition_test(Condition *c) {
         return b;
 }
 
+void condition_cache_begin(void) {
+
+        /* Memoize condition results until condition_cache_end() is
+         * called. Many units tend to check the very same things. */
+
+        cache_active = true;
+        cache_hits = 0;
+}
+
+void condition_cache_end(void) {
+        char *k;
+
+        /* The hostname may change any time, so drop everything that
+         * was learnt during the batch */
+
+        cache_active = false;
+
+        while ((k = hashmap_steal_first_key(cache)))
+                free(k);
+
+        hashmap_free(cache);
+        cache = NULL;
+
+        strv_free(cached_cmdline);
+        cached_cmdline = NULL;
+}
+
+unsigned condition_cache_hits(void) {
+
+        /* Returns how many conditions were answered from the cache
+         * since the last condition_cache_begin() */
+
+        return cache_hits;
+}
+
 void condition_dump(Condition *c, FILE *f, const char *prefix, const char *(*to_string)(ConditionType t)) {
         assert(c);
         assert(f);
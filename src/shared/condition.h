@@ -83,6 +83,10 @@ Condition* condition_free_list(Condition *c);
 
 int condition_test(Condition *c);
 
+void condition_cache_begin(void);
+void condition_cache_end(void);
+unsigned condition_cache_hits(void);
+
 void condition_dump(Condition *c, FILE *f, const char *prefix, const char *(*to_string)(ConditionType t));
 void condition_dump_list(Condition *c, FILE *f, const char *prefix, const char *(*to_string)(ConditionType t));
 
@@ -1225,7 +1225,8 @@ int add_match_this_boot(sd_journal *j, const char *machine) {
         return 0;
 }
 
-int show_journal_by_unit(
+int show_journal_by_unit_with_journal(
+                sd_journal *j,
                 FILE *f,
                 const char *unit,
                 OutputMode mode,
@@ -1234,13 +1235,12 @@ int show_journal_by_unit(
                 unsigned how_many,
                 uid_t uid,
                 OutputFlags flags,
-                int journal_open_flags,
                 bool system_unit,
                 bool *ellipsized) {
 
-        _cleanup_journal_close_ sd_journal*j = NULL;
         int r;
 
+        assert(j);
         assert(mode >= 0);
         assert(mode < _OUTPUT_MODE_MAX);
         assert(unit);
@@ -1248,9 +1248,10 @@ int show_journal_by_unit(
         if (how_many <= 0)
                 return 0;
 
-        r = sd_journal_open(&j, journal_open_flags);
-        if (r < 0)
-                return r;
+        /* The journal object may be reused for multiple units, so
+         * drop any matches of a previous query first, this saves
+         * reopening and remapping all journal files for each unit */
+        sd_journal_flush_matches(j);
 
         r = add_match_this_boot(j, NULL);
         if (r < 0)
@@ -1273,6 +1274,36 @@ int show_journal_by_unit(
         return show_journal(f, j, mode, n_columns, not_before, how_many, flags, ellipsized);
 }
 
+int show_journal_by_unit(
+                FILE *f,
+                const char *unit,
+                OutputMode mode,
+                unsigned n_columns,
+                usec_t not_before,
+                unsigned how_many,
+                uid_t uid,
+                OutputFlags flags,
+                int journal_open_flags,
+                bool system_unit,
+                bool *ellipsized) {
+
+        _cleanup_journal_close_ sd_journal*j = NULL;
+        int r;
+
+        assert(mode >= 0);
+        assert(mode < _OUTPUT_MODE_MAX);
+        assert(unit);
+
+        if (how_many <= 0)
+                return 0;
+
+        r = sd_journal_open(&j, journal_open_flags);
+        if (r < 0)
+                return r;
+
+        return show_journal_by_unit_with_journal(j, f, unit, mode, n_columns, not_before, how_many, uid, flags, system_unit, ellipsized);
+}
+
 static const char *const output_mode_table[_OUTPUT_MODE_MAX] = {
         [OUTPUT_SHORT] = "short",
         [OUTPUT_SHORT_ISO] = "short-iso",
@@ -45,6 +45,10 @@
 #define BUFFER_SIZE (256 * 1024)
 #define CONNECTIONS_MAX 256
 
+/* The remote host is looked up for each incoming connection, cache the
+ * result briefly so that connection bursts do not all block on NSS */
+#define RESOLVE_CACHE_USEC (5 * USEC_PER_SEC)
+
 static const char *arg_remote_host = NULL;
 
 typedef struct Context {
@@ -659,6 +663,12 @@ int main(int argc, char *argv[]) {
                 goto finish;
         }
 
+        r = sd_resolve_set_cache_usec(context.resolve, RESOLVE_CACHE_USEC);
+        if (r < 0) {
+                log_error_errno(r, "Failed to enable resolver cache: %m");
+                goto finish;
+        }
+
         sd_event_set_watchdog(context.event, true);
 
         n = sd_listen_fds(1);
@@ -42,6 +42,7 @@
 #include "sd-shutdown.h"
 #include "sd-login.h"
 #include "sd-bus.h"
+#include "sd-event.h"
 #include "log.h"
 #include "util.h"
 #include "macro.h"
@@ -64,6 +65,7 @@
 #include "spawn-polkit-agent.h"
 #include "install.h"
 #include "logs-show.h"
+#include "journal-internal.h"
 #include "socket-util.h"
 #include "fileio.h"
 #include "copy.h"
@@ -525,24 +527,12 @@ static int output_units_list(const UnitInfo *unit_infos, unsigned c) {
         return 0;
 }
 
-static int get_unit_list(
-                sd_bus *bus,
-                const char *machine,
-                char **patterns,
-                UnitInfo **unit_infos,
-                int c,
-                sd_bus_message **_reply) {
-
+static int new_unit_list_message(sd_bus *bus, sd_bus_message **ret) {
         _cleanup_bus_message_unref_ sd_bus_message *m = NULL;
-        _cleanup_bus_error_free_ sd_bus_error error = SD_BUS_ERROR_NULL;
-        _cleanup_bus_message_unref_ sd_bus_message *reply = NULL;
-        size_t size = c;
         int r;
-        UnitInfo u;
 
         assert(bus);
-        assert(unit_infos);
-        assert(_reply);
+        assert(ret);
 
         r = sd_bus_message_new_method_call(
                         bus,
@@ -559,11 +549,25 @@ static int get_unit_list(
         if (r < 0)
                 return bus_log_create_error(r);
 
-        r = sd_bus_call(bus, m, 0, &error, &reply);
-        if (r < 0) {
-                log_error("Failed to list units: %s", bus_error_message(&error, r));
-                return r;
-        }
+        *ret = m;
+        m = NULL;
+
+        return 0;
+}
+
+static int parse_unit_list_reply(
+                sd_bus_message *reply,
+                const char *machine,
+                char **patterns,
+                UnitInfo **unit_infos,
+                int c) {
+
+        size_t size = c;
+        UnitInfo u;
+        int r;
+
+        assert(reply);
+        assert(unit_infos);
 
         r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(ssssssouso)");
         if (r < 0)
@@ -587,6 +591,40 @@ static int get_unit_list(
         if (r < 0)
                 return bus_log_parse_error(r);
 
+        return c;
+}
+
+static int get_unit_list(
+                sd_bus *bus,
+                const char *machine,
+                char **patterns,
+                UnitInfo **unit_infos,
+                int c,
+                sd_bus_message **_reply) {
+
+        _cleanup_bus_message_unref_ sd_bus_message *m = NULL;
+        _cleanup_bus_error_free_ sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_bus_message_unref_ sd_bus_message *reply = NULL;
+        int r;
+
+        assert(bus);
+        assert(unit_infos);
+        assert(_reply);
+
+        r = new_unit_list_message(bus, &m);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_call(bus, m, 0, &error, &reply);
+        if (r < 0) {
+                log_error("Failed to list units: %s", bus_error_message(&error, r));
+                return r;
+        }
+
+        c = parse_unit_list_reply(reply, machine, patterns, unit_infos, c);
+        if (c < 0)
+                return c;
+
         *_reply = reply;
         reply = NULL;
 
@@ -602,6 +640,126 @@ static void message_set_freep(Set **set) {
         set_free(*set);
 }
 
+/* Maximum number of containers we talk to in parallel when listing
+ * units recursively */
+#define MACHINE_QUERIES_MAX 16
+
+typedef struct MachineQuery {
+        const char *machine;
+        sd_bus *bus;
+        sd_bus_slot *slot;
+        sd_bus_message *reply;
+        bool connected;
+} MachineQuery;
+
+typedef struct MachineQueries {
+        sd_event *event;
+        MachineQuery *queries;
+        unsigned n_queries;
+        unsigned n_started;
+        unsigned n_running;
+} MachineQueries;
+
+static void machine_query_close(MachineQuery *q) {
+        assert(q);
+
+        q->slot = sd_bus_slot_unref(q->slot);
+
+        if (q->bus) {
+                sd_bus_detach_event(q->bus);
+                sd_bus_close(q->bus);
+                q->bus = sd_bus_unref(q->bus);
+        }
+}
+
+static void machine_queries_done(MachineQueries *mq) {
+        unsigned i;
+
+        assert(mq);
+
+        for (i = 0; i < mq->n_queries; i++) {
+                machine_query_close(mq->queries + i);
+                sd_bus_message_unref(mq->queries[i].reply);
+        }
+
+        free(mq->queries);
+        sd_event_unref(mq->event);
+}
+
+static int machine_queries_start_next(MachineQueries *mq);
+
+static int on_machine_unit_list(sd_bus *bus, sd_bus_message *reply, void *userdata, sd_bus_error *error) {
+        MachineQueries *mq = userdata;
+        unsigned i;
+        int r;
+
+        assert(mq);
+
+        for (i = 0; i < mq->n_started; i++)
+                if (mq->queries[i].bus == bus)
+                        break;
+
+        assert(i < mq->n_started);
+
+        mq->queries[i].reply = sd_bus_message_ref(reply);
+
+        /* We got all we need, don't keep the connection around
+         * while waiting for the others */
+        machine_query_close(mq->queries + i);
+
+        assert(mq->n_running > 0);
+        mq->n_running--;
+
+        r = machine_queries_start_next(mq);
+        if (r < 0)
+                return sd_event_exit(mq->event, r);
+
+        return 0;
+}
+
+static int machine_queries_start_next(MachineQueries *mq) {
+        int r;
+
+        assert(mq);
+
+        /* Fill up the free query slots. Connecting to a container
+         * is done synchronously, but authentication, Hello() and
+         * the actual ListUnitsFiltered() call are then processed
+         * in parallel for all machines by the event loop. */
+
+        while (mq->n_running < MACHINE_QUERIES_MAX && mq->n_started < mq->n_queries) {
+                _cleanup_bus_message_unref_ sd_bus_message *m = NULL;
+                MachineQuery *q = mq->queries + mq->n_started++;
+
+                r = sd_bus_open_system_machine(&q->bus, q->machine);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to connect to container %s: %m", q->machine);
+                        continue;
+                }
+
+                q->connected = true;
+
+                r = sd_bus_attach_event(q->bus, mq->event, 0);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to attach bus to event loop: %m");
+
+                r = new_unit_list_message(q->bus, &m);
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_call_async(q->bus, &q->slot, m, on_machine_unit_list, mq, 0);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to issue method call: %m");
+
+                mq->n_running++;
+        }
+
+        if (mq->n_running <= 0)
+                return sd_event_exit(mq->event, 0);
+
+        return 0;
+}
+
 static int get_unit_list_recursive(
                 sd_bus *bus,
                 char **patterns,
@@ -634,34 +792,68 @@ static int get_unit_list_recursive(
         }
 
         if (arg_recursive) {
+                _cleanup_(machine_queries_done) MachineQueries mq = {};
                 _cleanup_strv_free_ char **machines = NULL;
-                char **i;
+                unsigned i;
 
                 r = sd_get_machine_names(&machines);
                 if (r < 0)
                         return r;
 
-                STRV_FOREACH(i, machines) {
-                        _cleanup_bus_close_unref_ sd_bus *container = NULL;
+                mq.n_queries = strv_length(machines);
+                if (mq.n_queries > 0) {
+                        mq.queries = new0(MachineQuery, mq.n_queries);
+                        if (!mq.queries)
+                                return log_oom();
+
+                        for (i = 0; i < mq.n_queries; i++)
+                                mq.queries[i].machine = machines[i];
+
+                        r = sd_event_new(&mq.event);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to allocate event loop: %m");
+
+                        r = machine_queries_start_next(&mq);
+                        if (r < 0)
+                                return r;
+
+                        r = sd_event_loop(mq.event);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to run event loop: %m");
+                }
+
+                /* Collect the results in the order of the machines */
+                for (i = 0; i < mq.n_queries; i++) {
+                        MachineQuery *q = mq.queries + i;
+                        const sd_bus_error *e;
                         int k;
 
-                        r = sd_bus_open_system_machine(&container, *i);
-                        if (r < 0) {
-                                log_error_errno(r, "Failed to connect to container %s: %m", *i);
+                        if (!q->connected)
                                 continue;
+
+                        if (!q->reply) {
+                                log_error("Failed to list units of container %s: Connection terminated", q->machine);
+                                return -ECONNRESET;
                         }
 
-                        k = get_unit_list(container, *i, patterns, &unit_infos, c, &reply);
+                        e = sd_bus_message_get_error(q->reply);
+                        if (e) {
+                                r = sd_bus_message_get_errno(q->reply);
+                                log_error("Failed to list units: %s", bus_error_message(e, r));
+                                return -r;
+                        }
+
+                        k = parse_unit_list_reply(q->reply, q->machine, patterns, &unit_infos, c);
                         if (k < 0)
                                 return k;
 
                         c = k;
 
-                        r = set_put(replies, reply);
-                        if (r < 0) {
-                                sd_bus_message_unref(reply);
+                        r = set_put(replies, q->reply);
+                        if (r < 0)
                                 return r;
-                        }
+
+                        q->reply = NULL;
                 }
 
                 *_machines = machines;
@@ -3009,6 +3201,100 @@ static int start_special(sd_bus *bus, char **args) {
         return r;
 }
 
+static int check_units_by_names(sd_bus *bus, char **names, const char *good_states, bool quiet) {
+        _cleanup_bus_error_free_ sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_bus_message_unref_ sd_bus_message *m = NULL, *reply = NULL;
+        _cleanup_free_ UnitInfo *unit_infos = NULL;
+        _cleanup_strv_free_ char **mangled = NULL;
+        size_t size = 0;
+        unsigned c = 0, k;
+        bool found = false;
+        char **name;
+        UnitInfo u;
+        int r;
+
+        assert(bus);
+
+        /* Queries the state of all units in a single round trip,
+         * instead of one GetUnit() call plus one property request per
+         * unit. Returns -EOPNOTSUPP if ListUnitsByNames() cannot be
+         * used, so that the caller falls back to per-unit queries. */
+
+        STRV_FOREACH(name, names) {
+                char *n;
+
+                n = unit_name_mangle(*name, MANGLE_NOGLOB);
+                if (!n)
+                        return log_oom();
+
+                if (strv_consume(&mangled, n) < 0)
+                        return log_oom();
+        }
+
+        r = sd_bus_message_new_method_call(
+                        bus,
+                        &m,
+                        "org.freedesktop.systemd1",
+                        "/org/freedesktop/systemd1",
+                        "org.freedesktop.systemd1.Manager",
+                        "ListUnitsByNames");
+        if (r < 0)
+                return bus_log_create_error(r);
+
+        r = sd_bus_message_append_strv(m, mangled);
+        if (r < 0)
+                return bus_log_create_error(r);
+
+        r = sd_bus_call(bus, m, 0, &error, &reply);
+        if (r < 0) {
+                /* Older managers don't know the method, and older
+                 * bus policies might not allow calling it, hence
+                 * don't fail, but try the old way instead. */
+                log_debug("Failed to list units by names, querying them one by one: %s", bus_error_message(&error, r));
+                return -EOPNOTSUPP;
+        }
+
+        r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(ssssssouso)");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        while ((r = bus_parse_unit_info(reply, &u)) > 0) {
+                if (!GREEDY_REALLOC(unit_infos, size, c+1))
+                        return log_oom();
+
+                unit_infos[c++] = u;
+        }
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        r = sd_bus_message_exit_container(reply);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        /* The manager replies with exactly one entry per name, in
+         * the order they were specified. Note that the entries carry
+         * the unit's main name, which is not necessarily the one we
+         * asked for, hence match them up by position. */
+        if (c != strv_length(mangled)) {
+                log_error("Unexpected number of units in reply.");
+                return -EBADMSG;
+        }
+
+        for (k = 0; k < c; k++) {
+                const char *state;
+
+                state = isempty(unit_infos[k].active_state) ? NULL : unit_infos[k].active_state;
+
+                if (!quiet)
+                        puts(state ?: "unknown");
+
+                if (state && nulstr_contains(good_states, state))
+                        found = true;
+        }
+
+        return found;
+}
+
 static int check_unit_generic(sd_bus *bus, int code, const char *good_states, char **args) {
         _cleanup_strv_free_ char **names = NULL;
         char **name;
@@ -3022,6 +3308,14 @@ static int check_unit_generic(sd_bus *bus, int code, const char *good_states, ch
         if (r < 0)
                 return log_error_errno(r, "Failed to expand names: %m");
 
+        r = check_units_by_names(bus, names, good_states, arg_quiet);
+        if (r != -EOPNOTSUPP) {
+                if (r < 0)
+                        return r;
+
+                return r > 0 ? 0 : code;
+        }
+
         STRV_FOREACH(name, names) {
                 int state;
 
@@ -3259,6 +3553,7 @@ typedef struct UnitStatusInfo {
 
 static void print_status_info(
                 UnitStatusInfo *i,
+                sd_journal **journal,
                 bool *ellipsized) {
 
         ExecStatusInfo *p;
@@ -3560,19 +3855,25 @@ static void print_status_info(
                 }
         }
 
-        if (i->id && arg_transport == BUS_TRANSPORT_LOCAL) {
-                show_journal_by_unit(
-                                stdout,
-                                i->id,
-                                arg_output,
-                                0,
-                                i->inactive_exit_timestamp_monotonic,
-                                arg_lines,
-                                getuid(),
-                                get_output_flags() | OUTPUT_BEGIN_NEWLINE,
-                                SD_JOURNAL_LOCAL_ONLY,
-                                arg_scope == UNIT_FILE_SYSTEM,
-                                ellipsized);
+        if (i->id && arg_transport == BUS_TRANSPORT_LOCAL && arg_lines > 0) {
+                /* Open the journal only once and reuse it for all
+                 * units we show the status of */
+                if (!*journal)
+                        (void) sd_journal_open(journal, SD_JOURNAL_LOCAL_ONLY);
+
+                if (*journal)
+                        show_journal_by_unit_with_journal(
+                                        *journal,
+                                        stdout,
+                                        i->id,
+                                        arg_output,
+                                        0,
+                                        i->inactive_exit_timestamp_monotonic,
+                                        arg_lines,
+                                        getuid(),
+                                        get_output_flags() | OUTPUT_BEGIN_NEWLINE,
+                                        arg_scope == UNIT_FILE_SYSTEM,
+                                        ellipsized);
         }
 
         if (i->need_daemon_reload)
@@ -4221,6 +4522,7 @@ static int show_one(
                 const char *unit,
                 bool show_properties,
                 bool *new_line,
+                sd_journal **journal,
                 bool *ellipsized) {
 
         _cleanup_bus_message_unref_ sd_bus_message *reply = NULL;
@@ -4349,7 +4651,7 @@ static int show_one(
         } else if (streq(verb, "help"))
                 show_unit_help(&info);
         else if (streq(verb, "status")) {
-                print_status_info(&info, ellipsized);
+                print_status_info(&info, journal, ellipsized);
 
                 if (info.active_state && !STR_IN_SET(info.active_state, "active", "reloading"))
                         r = EXIT_PROGRAM_NOT_RUNNING;
@@ -4410,6 +4712,7 @@ static int show_all(
                 sd_bus *bus,
                 bool show_properties,
                 bool *new_line,
+                sd_journal **journal,
                 bool *ellipsized) {
 
         _cleanup_bus_message_unref_ sd_bus_message *reply = NULL;
@@ -4435,7 +4738,7 @@ static int show_all(
                 if (!p)
                         return log_oom();
 
-                r = show_one(verb, bus, p, u->id, show_properties, new_line, ellipsized);
+                r = show_one(verb, bus, p, u->id, show_properties, new_line, journal, ellipsized);
                 if (r < 0)
                         return r;
                 else if (r > 0 && ret == 0)
@@ -4502,6 +4805,7 @@ static int show_system_status(sd_bus *bus) {
 }
 
 static int show(sd_bus *bus, char **args) {
+        _cleanup_journal_close_ sd_journal *journal = NULL;
         bool show_properties, show_status, new_line = false;
         bool ellipsized = false;
         int r, ret = 0;
@@ -4523,7 +4827,7 @@ static int show(sd_bus *bus, char **args) {
 
         /* If no argument is specified inspect the manager itself */
         if (show_properties && strv_length(args) <= 1)
-                return show_one(args[0], bus, "/org/freedesktop/systemd1", NULL, show_properties, &new_line, &ellipsized);
+                return show_one(args[0], bus, "/org/freedesktop/systemd1", NULL, show_properties, &new_line, &journal, &ellipsized);
 
         if (show_status && strv_length(args) <= 1) {
 
@@ -4532,7 +4836,7 @@ static int show(sd_bus *bus, char **args) {
                 new_line = true;
 
                 if (arg_all)
-                        ret = show_all(args[0], bus, false, &new_line, &ellipsized);
+                        ret = show_all(args[0], bus, false, &new_line, &journal, &ellipsized);
         } else {
                 _cleanup_free_ char **patterns = NULL;
                 char **name;
@@ -4564,7 +4868,7 @@ static int show(sd_bus *bus, char **args) {
                                         return log_oom();
                         }
 
-                        r = show_one(args[0], bus, path, unit, show_properties, &new_line, &ellipsized);
+                        r = show_one(args[0], bus, path, unit, show_properties, &new_line, &journal, &ellipsized);
                         if (r < 0)
                                 return r;
                         else if (r > 0 && ret == 0)
@@ -4585,7 +4889,7 @@ static int show(sd_bus *bus, char **args) {
                                 if (!path)
                                         return log_oom();
 
-                                r = show_one(args[0], bus, path, *name, show_properties, &new_line, &ellipsized);
+                                r = show_one(args[0], bus, path, *name, show_properties, &new_line, &journal, &ellipsized);
                                 if (r < 0)
                                         return r;
                                 if (r > 0 && ret == 0)
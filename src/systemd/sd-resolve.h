@@ -80,6 +80,12 @@ int sd_resolve_wait(sd_resolve *resolve, uint64_t timeout_usec);
 
 int sd_resolve_get_tid(sd_resolve *resolve, pid_t *tid);
 
+/* Enable caching of getaddrinfo() results for the specified time. Both
+ * successful lookups and definitive negative replies are cached. Pass
+ * 0 to disable the cache, which is the default. */
+int sd_resolve_set_cache_usec(sd_resolve *resolve, uint64_t usec);
+int sd_resolve_get_cache_stats(sd_resolve *resolve, unsigned *hits, unsigned *misses);
+
 int sd_resolve_attach_event(sd_resolve *resolve, sd_event *e, int priority);
 int sd_resolve_detach_event(sd_resolve *resolve);
 sd_event *sd_resolve_get_event(sd_resolve *resolve);
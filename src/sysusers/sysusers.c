@@ -81,6 +81,17 @@ static uid_t search_uid = UID_INVALID;
 static UidRange *uid_range = NULL;
 static unsigned n_uid_range = 0;
 
+/* Bitmaps of IDs below n_used_ids known to be taken by a user
+ * resp. a group, so that the search for a free ID doesn't need to
+ * probe each candidate individually. */
+static uint64_t *used_uids = NULL, *used_gids = NULL;
+static uid_t n_used_ids = 0;
+static bool used_ids_loaded = false;
+
+/* Don't bother with the bitmaps if the allocation ranges reach
+ * further up than this */
+#define USED_IDS_MAX (1U << 24)
+
 #define fix_root(x) (arg_root ? strjoina(arg_root, x) : x)
 
 static int load_user_database(void) {
@@ -187,6 +198,124 @@ static int load_group_database(void) {
         return 0;
 }
 
+static void id_mark(uint64_t *map, uid_t id) {
+        if (!map || id >= n_used_ids)
+                return;
+
+        map[id / 64] |= UINT64_C(1) << (id % 64);
+}
+
+static bool id_marked(const uint64_t *map, uid_t id) {
+        if (!map || id >= n_used_ids)
+                return false;
+
+        return map[id / 64] & (UINT64_C(1) << (id % 64));
+}
+
+static int load_used_ids(void) {
+        Iterator iterator;
+        uid_t top;
+        size_t n;
+        void *k, *v;
+
+        assert(uid_range);
+        assert(n_uid_range > 0);
+
+        /* This is only done the first time an ID needs to be
+         * allocated, since most runs don't need to allocate one. */
+        if (used_ids_loaded)
+                return 0;
+
+        used_ids_loaded = true;
+
+        /* The ranges are sorted, hence the last one ends highest */
+        top = uid_range[n_uid_range - 1].start + uid_range[n_uid_range - 1].nr - 1;
+        if (top >= USED_IDS_MAX)
+                return 0;
+
+        n = DIV_ROUND_UP((size_t) top + 1, 64);
+        used_uids = new0(uint64_t, n);
+        used_gids = new0(uint64_t, n);
+        if (!used_uids || !used_gids)
+                return -ENOMEM;
+
+        n_used_ids = top + 1;
+
+        HASHMAP_FOREACH_KEY(v, k, database_uid, iterator)
+                id_mark(used_uids, PTR_TO_UID(k));
+
+        HASHMAP_FOREACH_KEY(v, k, database_gid, iterator)
+                id_mark(used_gids, PTR_TO_GID(k));
+
+        HASHMAP_FOREACH_KEY(v, k, todo_uids, iterator)
+                id_mark(used_uids, PTR_TO_UID(k));
+
+        HASHMAP_FOREACH_KEY(v, k, todo_gids, iterator)
+                id_mark(used_gids, PTR_TO_GID(k));
+
+        /* Pick up everything NSS is willing to enumerate in one go,
+         * instead of asking for every candidate separately. Not
+         * all backends enumerate, hence the chosen ID is still
+         * verified individually. This is merely an optimization,
+         * so failures are ignored. */
+        if (!arg_root) {
+                struct passwd *pw;
+                struct group *gr;
+
+                setpwent();
+                while ((pw = getpwent()))
+                        id_mark(used_uids, pw->pw_uid);
+                endpwent();
+
+                setgrent();
+                while ((gr = getgrent()))
+                        id_mark(used_gids, gr->gr_gid);
+                endgrent();
+        }
+
+        return 0;
+}
+
+static int next_free_id(bool group) {
+        int r;
+
+        /* Finds the next lower candidate from the allocation ranges
+         * that is not known to be taken yet. For users only IDs of
+         * other users are excluded here, since they may share the
+         * ID with a group of the same name, see uid_is_ok(). */
+
+        r = load_used_ids();
+        if (r < 0)
+                return r;
+
+        for (;;) {
+                uint64_t used, mask;
+                uid_t bit;
+
+                r = uid_range_next_lower(uid_range, n_uid_range, &search_uid);
+                if (r < 0)
+                        return r;
+
+                if (!id_marked(used_uids, search_uid) &&
+                    !(group && id_marked(used_gids, search_uid)))
+                        return 0;
+
+                /* If everything from the start of this word up to
+                 * the candidate is taken, skip the whole word */
+                bit = search_uid % 64;
+                if (search_uid == bit)
+                        continue;
+
+                used = used_uids[search_uid / 64];
+                if (group)
+                        used |= used_gids[search_uid / 64];
+
+                mask = bit == 63 ? UINT64_MAX : (UINT64_C(1) << (bit + 1)) - 1;
+                if ((used & mask) == mask)
+                        search_uid -= bit;
+        }
+}
+
 static int make_backup(const char *target, const char *x) {
         _cleanup_close_ int src = -1;
         _cleanup_fclose_ FILE *dst = NULL;
@@ -948,7 +1077,7 @@ static int add_user(Item *i) {
         /* And if that didn't work either, let's try to find a free one */
         if (!i->uid_set) {
                 for (;;) {
-                        r = uid_range_next_lower(uid_range, n_uid_range, &search_uid);
+                        r = next_free_id(false);
                         if (r < 0) {
                                 log_error("No free user ID available for %s.", i->name);
                                 return r;
@@ -973,6 +1102,8 @@ static int add_user(Item *i) {
         if (r < 0)
                 return log_oom();
 
+        id_mark(used_uids, i->uid);
+
         i->todo_user = true;
         log_info("Creating user %s (%s) with uid " UID_FMT " and gid " GID_FMT ".", i->name, strna(i->description), i->uid, i->gid);
 
@@ -1093,7 +1224,7 @@ static int add_group(Item *i) {
         if (!i->gid_set) {
                 for (;;) {
                         /* We look for new GIDs in the UID pool! */
-                        r = uid_range_next_lower(uid_range, n_uid_range, &search_uid);
+                        r = next_free_id(true);
                         if (r < 0) {
                                 log_error("No free group ID available for %s.", i->name);
                                 return r;
@@ -1118,6 +1249,8 @@ static int add_group(Item *i) {
         if (r < 0)
                 return log_oom();
 
+        id_mark(used_gids, i->gid);
+
         i->todo_group = true;
         log_info("Creating group %s with gid " GID_FMT ".", i->name, i->gid);
 
@@ -1915,6 +2048,9 @@ finish:
         free_database(database_user, database_uid);
         free_database(database_group, database_gid);
 
+        free(used_uids);
+        free(used_gids);
+
         free(arg_root);
 
         return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
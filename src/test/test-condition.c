@@ -180,6 +180,60 @@ static void test_condition_test_kernel_command_line(void) {
         condition_free(condition);
 }
 
+static void test_condition_cache(void) {
+        char p[] = "/tmp/test-condition-cache.XXXXXX";
+        Condition *condition;
+        int fd;
+
+        fd = mkostemp_safe(p, O_RDWR|O_CLOEXEC);
+        assert_se(fd >= 0);
+        safe_close(fd);
+
+        condition = condition_new(CONDITION_PATH_EXISTS, p, false, false);
+
+        /* Paths may be changed by other units of the same batch,
+         * hence are never remembered */
+        condition_cache_begin();
+        assert_se(condition_test(condition));
+        assert_se(unlink(p) >= 0);
+        assert_se(!condition_test(condition));
+        assert_se(condition->result == CONDITION_FAILED);
+        condition_free(condition);
+
+        assert_se(condition_cache_hits() == 0);
+
+        condition = condition_new(CONDITION_KERNEL_COMMAND_LINE, "andthatshouldbeinvalidtoo=1", false, false);
+        assert_se(!condition_test(condition));
+        assert_se(condition_cache_hits() == 0);
+        assert_se(!condition_test(condition));
+        assert_se(condition_cache_hits() == 1);
+        condition_free(condition);
+
+        /* The same check of another unit is answered from the
+         * cache too, while negation is still applied per condition */
+        condition = condition_new(CONDITION_KERNEL_COMMAND_LINE, "andthatshouldbeinvalidtoo=1", false, true);
+        assert_se(condition_test(condition));
+        assert_se(condition_cache_hits() == 2);
+        condition_free(condition);
+
+        /* Failures are not remembered */
+        condition = condition_new(CONDITION_ARCHITECTURE, "garbage value jjjjjjjjjjjjjj", false, false);
+        assert_se(condition_test(condition) < 0);
+        assert_se(condition_test(condition) < 0);
+        assert_se(condition_cache_hits() == 2);
+        condition_free(condition);
+        condition_cache_end();
+
+        condition = condition_new(CONDITION_KERNEL_COMMAND_LINE, "andthatshouldbeinvalidtoo=1", false, false);
+        assert_se(!condition_test(condition));
+        assert_se(condition_cache_hits() == 2);
+        condition_free(condition);
+
+        condition_cache_begin();
+        assert_se(condition_cache_hits() == 0);
+        condition_cache_end();
+}
+
 static void test_condition_test_null(void) {
         Condition *condition;
 
@@ -230,6 +284,7 @@ int main(int argc, char *argv[]) {
         test_condition_test_host();
         test_condition_test_architecture();
         test_condition_test_kernel_command_line();
+        test_condition_cache();
         test_condition_test_null();
         test_condition_test_security();
 